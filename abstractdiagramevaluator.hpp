@@ -4,20 +4,42 @@
 #include "diagramexecutioncontext.hpp"
 #include "diagram.hpp"
 
+class ThreadPool;
+
 
 struct AbstractDiagramEvaluator {
   const DiagramExecutionContext &context;
 
+  ThreadPool *thread_pool_ptr = nullptr;
+    // If this is set, maybeEvaluateIn() may be called for different
+    // diagrams from the threads of this pool at the same time.
+
   AbstractDiagramEvaluator(const DiagramExecutionContext &context_arg)
   : context(context_arg)
   {
   }
 
-  virtual Optional<Any>
+  Optional<Any>
     maybeEvaluate(
       const Diagram &diagram,
       const Environment *parent_environment_ptr,
       const Optional<std::string> &optional_expected_type_name = {}
+    )
+  {
+    return
+      maybeEvaluateIn(
+        context,diagram,parent_environment_ptr,optional_expected_type_name
+      );
+  }
+
+  // This is like maybeEvaluate(), but the output goes to the streams of
+  // the given context.
+  virtual Optional<Any>
+    maybeEvaluateIn(
+      const DiagramExecutionContext &,
+      const Diagram &diagram,
+      const Environment *parent_environment_ptr,
+      const Optional<std::string> &optional_expected_type_name
     ) = 0;
 };
 
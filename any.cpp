@@ -1,6 +1,35 @@
 #include "any.hpp"
 
 
+Optional<Any>
+  Object::Data::maybeMethodMember(const Symbol &member_name) const
+{
+  for (const Method &method : methods()) {
+    if (method.name==member_name) {
+      return member(member_name);
+    }
+  }
+
+  return {};
+}
+
+
+Optional<Any> Object::Data::maybeMember(const Symbol &member_name) const
+{
+  Optional<Any> maybe_method = maybeMethodMember(member_name);
+
+  if (maybe_method) {
+    return maybe_method;
+  }
+
+  if (!contains(memberNames(),member_name.str())) {
+    return {};
+  }
+
+  return member(member_name);
+}
+
+
 Object &Object::operator=(const Object &arg)
 {
   if (&arg==this) {
@@ -9,14 +38,14 @@ Object &Object::operator=(const Object &arg)
 
   assert(arg.data_ptr);
 
-  data_ptr.reset(arg.data_ptr->clone());
+  data_ptr = arg.data_ptr;
   return *this;
 }
 
 
 Optional<Object>
   Class::maybeMakeObject(
-    const NamedParameters &parameters,
+    const Arguments &parameters,
     std::ostream &error_stream
   ) const
 {
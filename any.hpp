@@ -9,6 +9,9 @@
 #include "contains.hpp"
 #include "optional.hpp"
 #include "basicvariant.hpp"
+#include "symbol.hpp"
+#include "floatvector.hpp"
+#include "cowvalue.hpp"
 
 
 struct AnyPolicy;
@@ -16,41 +19,114 @@ struct Object;
 
 using Any = BasicVariant<AnyPolicy>;
 
+
+// A view of the arguments for a call.  The arguments are normally on
+// the evaluation stack, so passing them doesn't require an allocation.
+class Arguments {
+  public:
+    Arguments(const Any *begin_arg,const Any *end_arg)
+    : begin_ptr(begin_arg),
+      end_ptr(end_arg)
+    {
+    }
+
+    inline Arguments(const std::vector<Any> &);
+
+    inline int size() const;
+    const Any *begin() const { return begin_ptr; }
+    const Any *end() const { return end_ptr; }
+    inline const Any &operator[](int index) const;
+
+  private:
+    const Any *begin_ptr;
+    const Any *end_ptr;
+};
+
+
+// Classes declare the names of their parameters when they are created.
+// When an object is made, the arguments are given in the same order as
+// the parameter names, and parameters that weren't given are void.
 class Class {
   public:
-    using NamedParameters = std::map<std::string,Any>;
     using MakeObjectSignature =
-      Optional<Object>(const NamedParameters &,std::ostream &error_stream);
+      Optional<Object>(const Arguments &,std::ostream &error_stream);
     using MakeObjectFunction = std::function<MakeObjectSignature>;
 
+    Class(
+      std::vector<Symbol> parameter_names_arg,
+      MakeObjectFunction make_object_function_arg
+    )
+    : parameter_names(std::move(parameter_names_arg)),
+      make_object_function(std::move(make_object_function_arg))
+    {
+    }
+
     Class(MakeObjectFunction make_object_function_arg)
-    : make_object_function(std::move(make_object_function_arg))
+    : Class({},std::move(make_object_function_arg))
     {
     }
 
     bool operator==(const Class &) const;
 
+    const std::vector<Symbol> &parameterNames() const
+    {
+      return parameter_names;
+    }
+
     Optional<Object>
       maybeMakeObject(
-        const NamedParameters &parameters,
+        const Arguments &parameters,
         std::ostream &error_stream
       ) const;
 
   private:
+    std::vector<Symbol> parameter_names;
     MakeObjectFunction make_object_function;
 };
 
 
 // This is the base class for dynamic objects that can hold arbitrary
-// members with dynamic values.
+// members with dynamic values.  Copies of an object share the same data
+// until one of them needs to modify it.
 class Object {
   public:
+    struct Data;
+
+    // Native object types list their callable members in a static method
+    // table.  A call like obj.f(...) can then call the method directly
+    // instead of getting the member as a Function first.
+    struct Method {
+      using Call = Optional<Any>(const Data &,const Arguments &);
+
+      Symbol name;
+      Call *call_ptr;
+    };
+
+    using MethodTable = std::vector<Method>;
+
     struct Data {
       virtual Data *clone() = 0;
       virtual std::string typeName() const = 0;
-      virtual Any member(const std::string &member_name) const = 0;
+      virtual Any member(const Symbol &member_name) const = 0;
       virtual std::vector<std::string> memberNames() const = 0;
+
+      // This checks methods() and then memberNames() before getting the
+      // member.  Types that can find their members directly can override
+      // it.
+      virtual Optional<Any> maybeMember(const Symbol &member_name) const;
+
+      virtual const MethodTable &methods() const
+      {
+        static const MethodTable no_methods;
+        return no_methods;
+      }
+
       virtual ~Data() {}
+
+      protected:
+        Optional<Any> maybeMethodMember(const Symbol &member_name) const;
+          // The member if it is one of the methods.  Methods can be found
+          // by their symbols without making the list of member names.
     };
 
     Object(std::unique_ptr<Data> data_ptr_arg)
@@ -60,7 +136,7 @@ class Object {
     }
 
     Object(const Object &arg)
-    : data_ptr(arg.data_ptr->clone())
+    : data_ptr(arg.data_ptr)
     {
     }
 
@@ -74,9 +150,26 @@ class Object {
       return *data_ptr;
     }
 
+    Data &mutableData()
+    {
+      assert(data_ptr);
+
+      if (data_ptr.use_count()!=1) {
+        data_ptr.reset(data_ptr->clone());
+      }
+
+      return *data_ptr;
+    }
+
+    bool isSharedWith(const Object &arg) const
+    {
+      return data_ptr==arg.data_ptr;
+    }
+
     std::string typeName() const { return data().typeName(); }
 
-    inline Optional<Any> maybeMember(const std::string &member_name) const;
+    inline Optional<Any> maybeMember(const Symbol &member_name) const;
+    inline const Method *maybeMethod(const Symbol &method_name) const;
 
     Object &operator=(const Object &arg);
 
@@ -87,16 +180,15 @@ class Object {
     }
 
   private:
-    std::unique_ptr<Data> data_ptr;
+    std::shared_ptr<Data> data_ptr;
 };
 
 
 struct Function {
-  using FunctionMember =
-    std::function<Optional<Any>(const std::vector<Any> &)>;
+  using FunctionMember = std::function<Optional<Any>(const Arguments &)>;
   FunctionMember function_member;
 
-  inline Optional<Any> operator()(const std::vector<Any> &parameters) const;
+  inline Optional<Any> operator()(const Arguments &parameters) const;
 
   bool operator==(const Function &) const
   {
@@ -113,6 +205,7 @@ struct AnyPolicy {
       float_type,
       string_type,
       vector_type,
+      float_vector_type,
       object_type,
       class_ptr_type,
       function_type
@@ -141,13 +234,19 @@ struct AnyPolicy {
     AnyPolicy(const std::string &arg)
     : _type(string_type)
     {
-      createObject(_possible_values.string_value,arg);
+      createObject(_possible_values.string_value,StringValue(arg));
     }
 
     AnyPolicy(std::vector<Any> &&arg)
     : _type(vector_type)
     {
-      createObject(_possible_values.vector_value,std::move(arg));
+      createObject(_possible_values.vector_value,VectorValue(std::move(arg)));
+    }
+
+    AnyPolicy(FloatVector arg)
+    : _type(float_vector_type)
+    {
+      createObject(_possible_values.float_vector_value,std::move(arg));
     }
 
     AnyPolicy(Object &&arg)
@@ -170,12 +269,18 @@ struct AnyPolicy {
 
     bool isVoid() const { return _type==void_type; }
     bool isVector() const { return _type==vector_type; }
+    bool isFloatVector() const { return _type==float_vector_type; }
     bool isFloat() const { return _type==float_type; }
     bool isString() const { return _type==string_type; }
     bool isObject() const { return _type==object_type; }
     bool isClassPtr() const { return _type==class_ptr_type; }
     bool isFunction() const { return _type==function_type; }
 
+    // Vectors of floats may be stored either way, and are equal if they
+    // have the same elements.
+    static inline bool
+      differentTypesAreEqual(const AnyPolicy &a,const AnyPolicy &b);
+
     static std::string voidTypeName() { return "void"; }
     static std::string floatTypeName() { return "float"; }
 
@@ -184,6 +289,7 @@ struct AnyPolicy {
       switch (_type) {
         case void_type: return voidTypeName();
         case vector_type: return "vector";
+        case float_vector_type: return "vector";
         case string_type: return "string";
         case float_type: return floatTypeName();
         case object_type: return asObject().typeName();
@@ -210,13 +316,19 @@ struct AnyPolicy {
     const std::string &asString() const
     {
       assert(_type==string_type);
-      return _possible_values.string_value;
+      return _possible_values.string_value.get();
     }
 
     const std::vector<Any> &asVector() const
     {
       assert(_type==vector_type);
-      return _possible_values.vector_value;
+      return _possible_values.vector_value.get();
+    }
+
+    const FloatVector &asFloatVector() const
+    {
+      assert(_type==float_vector_type);
+      return _possible_values.float_vector_value;
     }
 
     const Object &asObject() const
@@ -238,11 +350,17 @@ struct AnyPolicy {
     }
 
   protected:
+    // Strings and vectors are shared between copies, so copying an Any
+    // never copies them.
+    using StringValue = CowValue<std::string>;
+    using VectorValue = CowValue<std::vector<Any>>;
+
     union PossibleValues {
       Void void_value;
       float float_value;
-      std::string string_value;
-      std::vector<Any> vector_value;
+      StringValue string_value;
+      VectorValue vector_value;
+      FloatVector float_vector_value;
       Object object_value;
       Class *class_ptr_value;
       Function function_value;
@@ -259,6 +377,8 @@ struct AnyPolicy {
         case void_type:   return v(&PossibleValues::void_value);
         case string_type: return v(&PossibleValues::string_value);
         case vector_type: return v(&PossibleValues::vector_value);
+        case float_vector_type:
+          return v(&PossibleValues::float_vector_value);
         case object_type: return v(&PossibleValues::object_value);
         case class_ptr_type: return v(&PossibleValues::class_ptr_value);
         case function_type: return v(&PossibleValues::function_value);
@@ -272,20 +392,78 @@ struct AnyPolicy {
 };
 
 
-inline Optional<Any> Object::maybeMember(const std::string &member_name) const
+inline bool
+  AnyPolicy::differentTypesAreEqual(const AnyPolicy &a,const AnyPolicy &b)
+{
+  if (a.isFloatVector() && b.isVector()) {
+    return differentTypesAreEqual(b,a);
+  }
+
+  if (!a.isVector() || !b.isFloatVector()) {
+    return false;
+  }
+
+  const std::vector<Any> &a_vector = a.asVector();
+  const FloatVector &b_vector = b.asFloatVector();
+  int n = b_vector.size();
+
+  if (int(a_vector.size())!=n) {
+    return false;
+  }
+
+  for (int i=0; i!=n; ++i) {
+    if (!a_vector[i].isFloat() || a_vector[i].asFloat()!=b_vector[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+inline Optional<Any> Object::maybeMember(const Symbol &member_name) const
+{
+  assert(data_ptr);
+  return data_ptr->maybeMember(member_name);
+}
+
+
+inline const Object::Method *
+  Object::maybeMethod(const Symbol &method_name) const
 {
   assert(data_ptr);
 
-  if (!contains(data_ptr->memberNames(),member_name)) {
-    return {};
+  for (const Method &method : data_ptr->methods()) {
+    if (method.name==method_name) {
+      return &method;
+    }
   }
 
-  return data_ptr->member(member_name);
+  return nullptr;
+}
+
+
+inline Arguments::Arguments(const std::vector<Any> &arg)
+: Arguments(arg.data(),arg.data() + arg.size())
+{
+}
+
+
+inline int Arguments::size() const
+{
+  return end_ptr - begin_ptr;
+}
+
+
+inline const Any &Arguments::operator[](int index) const
+{
+  assert(index>=0 && index<size());
+  return begin_ptr[index];
 }
 
 
 inline Optional<Any>
-  Function::operator()(const std::vector<Any> &parameters) const
+  Function::operator()(const Arguments &parameters) const
 {
   assert(function_member);
   return function_member(parameters);
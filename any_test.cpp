@@ -33,7 +33,7 @@ static void testObject()
       assert(false);
     }
 
-    Any member(const string &/*member_name*/) const override
+    Any member(const Symbol &/*member_name*/) const override
     {
       assert(false);
     }
@@ -45,7 +45,7 @@ static void testObject()
   };
 
   auto make_test_object_function =
-    [&](const Class::NamedParameters &,ostream &/*error_stream*/){
+    [&](const Arguments &,ostream &/*error_stream*/){
       return Object(std::make_unique<Data>());
     };
 
@@ -61,7 +61,7 @@ static void testObject()
 static void testClass()
 {
   using MakeObjectSignature =
-    Optional<Object>(const Class::NamedParameters &,std::ostream &error_stream);
+    Optional<Object>(const Arguments &,std::ostream &error_stream);
   std::function<MakeObjectSignature> make_object_function;
   Class c(make_object_function);
   Any a(&c);
@@ -74,8 +74,8 @@ static void testFunction()
 {
   bool function_was_called = false;
 
-  std::function<Optional<Any>(const vector<Any> &)> f =
-    [&](const vector<Any> &) -> Optional<Any>
+  std::function<Optional<Any>(const Arguments &)> f =
+    [&](const Arguments &) -> Optional<Any>
     { function_was_called = true; return {5}; };
   Any a(Function{f});
   assert(a.isFunction());
@@ -100,7 +100,7 @@ static void testAssigningObject()
     Data *clone() override { return new ObjectData(*this); }
     std::string typeName() const override { return "Test"; }
 
-    Any member(const std::string &/*member_name*/) const override
+    Any member(const Symbol &/*member_name*/) const override
     {
       assert(false);
     }
@@ -119,6 +119,101 @@ static void testAssigningObject()
 }
 
 
+static void testFloatVector()
+{
+  Any a = FloatVector{1,2};
+  assert(a.isFloatVector());
+  assert(a.typeName()=="vector");
+  assert(a==Any(vector<Any>{1,2}));
+  assert(Any(vector<Any>{1,2})==a);
+  assert(a!=Any(vector<Any>{1,3}));
+  assert(a!=Any(vector<Any>{1,2,3}));
+
+  vector<Any> v;
+  v.push_back(1);
+  v.push_back(string("2"));
+  assert(a!=Any(std::move(v)));
+
+  std::ostringstream stream;
+  stream << a;
+  assert(stream.str()=="[1,2]");
+}
+
+
+static void testCopiesShareData()
+{
+  Any a = makeVector();
+  Any b(a);
+  assert(&a.asVector()==&b.asVector());
+
+  Any s = Any("test");
+  Any s2(s);
+  assert(&s.asString()==&s2.asString());
+
+  struct ObjectData : Object::Data {
+    int value = 0;
+    Data *clone() override { return new ObjectData(*this); }
+    std::string typeName() const override { return "Test"; }
+
+    Any member(const Symbol &/*member_name*/) const override
+    {
+      assert(false);
+    }
+
+    std::vector<std::string> memberNames() const override
+    {
+      assert(false);
+    }
+  };
+
+  Object object(make_unique<ObjectData>());
+  Object object2 = object;
+  assert(object.isSharedWith(object2));
+
+  static_cast<ObjectData &>(object2.mutableData()).value = 1;
+  assert(!object.isSharedWith(object2));
+  assert(static_cast<const ObjectData &>(object.data()).value==0);
+  assert(static_cast<const ObjectData &>(object2.data()).value==1);
+}
+
+
+static void testFindingAMethodMember()
+{
+  struct ObjectData : Object::Data {
+    Data *clone() override { return new ObjectData(*this); }
+    std::string typeName() const override { return "Test"; }
+
+    static Optional<Any> fMethod(const Data &,const Arguments &)
+    {
+      return Any(5);
+    }
+
+    Any member(const Symbol &member_name) const override
+    {
+      assert(member_name==Symbol("f"));
+      return Any(1);
+    }
+
+    std::vector<std::string> memberNames() const override
+    {
+      // Methods are found without making the list of member names.
+      assert(false);
+    }
+
+    const Object::MethodTable &methods() const override
+    {
+      static const Object::MethodTable methods = {{Symbol("f"),fMethod}};
+      return methods;
+    }
+  };
+
+  Object object(make_unique<ObjectData>());
+  Optional<Any> maybe_member = object.maybeMember(Symbol("f"));
+  assert(maybe_member);
+  assert(*maybe_member==Any(1));
+}
+
+
 int main()
 {
   testString();
@@ -127,4 +222,7 @@ int main()
   testFunction();
   testMemoryLeak1();
   testAssigningObject();
+  testFloatVector();
+  testCopiesShareData();
+  testFindingAMethodMember();
 }
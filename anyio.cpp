@@ -13,7 +13,7 @@ static void
   for (const auto &member_name : data.memberNames()) {
     printIndent(stream,indent_level+1);
     stream << member_name << ": ";
-    Any member_value = data.member(member_name);
+    Any member_value = data.member(Symbol(member_name));
     ::printOn(stream,member_value,indent_level + 1);
     stream << "\n";
   }
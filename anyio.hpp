@@ -48,6 +48,37 @@ inline void
 }
 
 
+template <typename T>
+inline void
+  printOn(std::ostream &stream,const CowValue<T> &arg,int indent_level)
+{
+  printOn(stream,arg.get(),indent_level);
+}
+
+
+template <>
+inline void
+  printOn(std::ostream &stream,const FloatVector &arg,int indent_level)
+{
+  stream << "[";
+
+  const float *iter = arg.begin();
+
+  if (iter!=arg.end()) {
+    printOn(stream,*iter,indent_level);
+    ++iter;
+  }
+
+  while (iter!=arg.end()) {
+    stream << ",";
+    printOn(stream,*iter,indent_level);
+    ++iter;
+  }
+
+  stream << "]";
+}
+
+
 template <>
 void printOn(std::ostream &stream,const Object &object,int indent_level);
 
@@ -0,0 +1,512 @@
+#include "anyoperations.hpp"
+
+#include "maybepoint2d.hpp"
+#include "floatkernels.hpp"
+
+using std::vector;
+using std::string;
+using std::ostream;
+
+
+// Vectors can either be packed vectors of floats or general vectors.
+// These functions let the operations treat them the same way.
+
+static bool isAnyVector(const Any &arg)
+{
+  return arg.isVector() || arg.isFloatVector();
+}
+
+
+static int vectorSize(const Any &arg)
+{
+  if (arg.isFloatVector()) {
+    return arg.asFloatVector().size();
+  }
+
+  return arg.asVector().size();
+}
+
+
+static Optional<float> maybeFloatElement(const Any &arg,int index)
+{
+  if (arg.isFloatVector()) {
+    return arg.asFloatVector()[index];
+  }
+
+  const Any &element = arg.asVector()[index];
+
+  if (!element.isFloat()) {
+    return {};
+  }
+
+  return element.asFloat();
+}
+
+
+// If both vectors are packed, the kernel is used, otherwise f is applied
+// to each pair of elements.
+template <typename Function>
+static Optional<Any>
+  maybeCombineVectors(
+    const Any &first_term,
+    const Any &second_term,
+    const char *operation_name,
+    FloatKernels::BinaryFunction &kernel,
+    const Function &f,
+    ostream &error_stream
+  )
+{
+  int n = vectorSize(first_term);
+
+  if (n != vectorSize(second_term)) {
+    error_stream << "Can't " << operation_name <<
+      " vectors of different sizes.\n";
+    return {};
+  }
+
+  FloatVector result(n);
+
+  if (first_term.isFloatVector() && second_term.isFloatVector()) {
+    kernel(
+      first_term.asFloatVector().begin(),
+      second_term.asFloatVector().begin(),
+      result.begin(),
+      n
+    );
+
+    return Any(std::move(result));
+  }
+
+  for (int i=0; i!=n; ++i) {
+    Optional<float> maybe_first_value = maybeFloatElement(first_term,i);
+    Optional<float> maybe_second_value = maybeFloatElement(second_term,i);
+
+    if (!maybe_first_value || !maybe_second_value) {
+      error_stream << "Can't " << operation_name <<
+        " vectors containing non-numeric values.\n";
+      return {};
+    }
+
+    result[i] = f(*maybe_first_value,*maybe_second_value);
+  }
+
+  return Any(std::move(result));
+}
+
+
+// This computes f(x,scalar) for each element x of the vector.
+template <typename Function>
+static Optional<Any>
+  maybeMapVector(
+    const Any &vector_term,
+    float scalar,
+    FloatKernels::ScalarFunction &kernel,
+    const Function &f,
+    const char *non_numeric_message,
+    ostream &error_stream
+  )
+{
+  int n = vectorSize(vector_term);
+  FloatVector result(n);
+
+  if (vector_term.isFloatVector()) {
+    kernel(vector_term.asFloatVector().begin(),scalar,result.begin(),n);
+    return Any(std::move(result));
+  }
+
+  for (int i=0; i!=n; ++i) {
+    Optional<float> maybe_value = maybeFloatElement(vector_term,i);
+
+    if (!maybe_value) {
+      error_stream << non_numeric_message;
+      return {};
+    }
+
+    result[i] = f(*maybe_value,scalar);
+  }
+
+  return Any(std::move(result));
+}
+
+
+static Optional<Any>
+  maybeScaleVector(
+    float first_float,
+    const Any &second_vector,
+    ostream &error_stream
+  )
+{
+  return
+    maybeMapVector(
+      second_vector,
+      first_float,
+      *floatKernels().scale,
+      [](float x,float s){ return s*x; },
+      "Invalid vector for scalar multiplication.\n",
+      error_stream
+    );
+}
+
+
+Optional<Any>
+  maybeAdd(const Any &first_term,const Any &second_term,ostream &error_stream)
+{
+  if (first_term.isFloat() && second_term.isFloat()) {
+    return Any(first_term.asFloat() + second_term.asFloat());
+  }
+
+  if (!isAnyVector(first_term) || !isAnyVector(second_term)) {
+    string first_term_type_name = first_term.typeName();
+    string second_term_type_name = second_term.typeName();
+    error_stream << "Invalid types for addition: " <<
+      first_term_type_name << " and " << second_term_type_name << ".\n";
+    return {};
+  }
+
+  return
+    maybeCombineVectors(
+      first_term,
+      second_term,
+      "add",
+      *floatKernels().add,
+      [](float a,float b){ return a + b; },
+      error_stream
+    );
+}
+
+
+Optional<Any>
+  maybeSubtract(
+    const Any &first_term,
+    const Any &second_term,
+    ostream &error_stream
+  )
+{
+  if (first_term.isFloat() && second_term.isFloat()) {
+    return Any(first_term.asFloat() - second_term.asFloat());
+  }
+
+  if (!isAnyVector(first_term) || !isAnyVector(second_term)) {
+    error_stream << "Invalid types for subtraction.\n";
+    return {};
+  }
+
+  return
+    maybeCombineVectors(
+      first_term,
+      second_term,
+      "subtract",
+      *floatKernels().subtract,
+      [](float a,float b){ return a - b; },
+      error_stream
+    );
+}
+
+
+Optional<Any>
+  maybeMultiply(
+    const Any &first_term,
+    const Any &second_term,
+    ostream &error_stream
+  )
+{
+  if (first_term.isFloat() && second_term.isFloat()) {
+    float first_float = first_term.asFloat();
+    float second_float = second_term.asFloat();
+    return Any(first_float * second_float);
+  }
+
+  if (first_term.isFloat() && isAnyVector(second_term)) {
+    return maybeScaleVector(first_term.asFloat(),second_term,error_stream);
+  }
+
+  if (isAnyVector(first_term) && second_term.isFloat()) {
+    return maybeScaleVector(second_term.asFloat(),first_term,error_stream);
+  }
+
+  error_stream << "Unhandled multiplication: " <<
+    first_term.typeName() << "*" <<
+    second_term.typeName() << "\n";
+
+  return {};
+}
+
+
+Optional<Any>
+  maybeDivide(
+    const Any &first_term,
+    const Any &second_term,
+    ostream &error_stream
+  )
+{
+  if (isAnyVector(first_term) && second_term.isFloat()) {
+    float second_float = second_term.asFloat();
+
+    return
+      maybeMapVector(
+        first_term,
+        second_float,
+        *floatKernels().divide,
+        [](float x,float s){ return x / s; },
+        "Can't divide a vector containing non-numeric values.\n",
+        error_stream
+      );
+  }
+  else if (first_term.isFloat() && second_term.isFloat()) {
+    return Any(first_term.asFloat() / second_term.asFloat());
+  }
+  else {
+    error_stream << "Unknown operation: " << first_term.typeName() << "/" <<
+      second_term.typeName() << "\n";
+  }
+
+  return {};
+}
+
+
+Any makeVectorValue(vector<Any>::iterator first,vector<Any>::iterator last)
+{
+  int n = last - first;
+  bool all_floats = n!=0;
+
+  for (auto iter = first; iter!=last; ++iter) {
+    if (!iter->isFloat()) {
+      all_floats = false;
+      break;
+    }
+  }
+
+  if (all_floats) {
+    FloatVector result(n);
+
+    for (int i=0; i!=n; ++i) {
+      result[i] = first[i].asFloat();
+    }
+
+    return Any(std::move(result));
+  }
+
+  vector<Any> result;
+  result.reserve(n);
+
+  for (auto iter = first; iter!=last; ++iter) {
+    result.push_back(std::move(*iter));
+  }
+
+  return Any(std::move(result));
+}
+
+
+Optional<Any>
+  maybeMemberOf(
+    const Any &first_term,
+    const Symbol &member_name,
+    ostream &error_stream
+  )
+{
+  if (Optional<Point2D> maybe_point2d = maybePoint2D(first_term)) {
+    static const Symbol x_symbol("x");
+    static const Symbol y_symbol("y");
+
+    if (member_name==x_symbol) {
+      return Any(maybe_point2d->x);
+    }
+
+    if (member_name==y_symbol) {
+      return Any(maybe_point2d->y);
+    }
+
+    return {};
+  }
+
+  if (!first_term.isObject()) {
+    error_stream <<
+      "Attempt to get member of " << first_term.typeName() << "\n";
+    return {};
+  }
+
+  Optional<Any> maybe_member = first_term.asObject().maybeMember(member_name);
+
+  if (!maybe_member) {
+    error_stream <<
+      first_term.typeName() << " has no member '" << member_name << "'\n";
+  }
+
+  return maybe_member;
+}
+
+
+static int
+  parameterIndex(const vector<Symbol> &parameter_names,const Symbol &name)
+{
+  int n_parameters = parameter_names.size();
+
+  for (int i=0; i!=n_parameters; ++i) {
+    if (parameter_names[i]==name) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+
+// The arguments are moved into a frame at the end of the stack, with a
+// slot for each of the class's parameters.  Since the stack is reused
+// between evaluations, this doesn't normally need to allocate.
+static bool
+  evaluateObjectConstruction(
+    vector<Any> &stack,
+    const Class &the_class,
+    const ArgumentNames &argument_names,
+    int n_extra,
+    ostream &error_stream
+  )
+{
+  int n_arguments = argument_names.size();
+  int arguments_index = stack.size() - n_arguments;
+  const vector<Symbol> &parameter_names = the_class.parameterNames();
+  int n_parameters = parameter_names.size();
+
+  for (const Symbol &argument_name : argument_names) {
+    if (argument_name.empty()) {
+      error_stream << "Class arguments must be named.\n";
+      stack.erase(stack.begin() + arguments_index - n_extra, stack.end());
+      return false;
+    }
+
+    if (parameterIndex(parameter_names,argument_name)<0) {
+      error_stream << "Unknown parameter '" << argument_name << "'\n";
+      stack.erase(stack.begin() + arguments_index - n_extra, stack.end());
+      return false;
+    }
+  }
+
+  int frame_index = stack.size();
+  stack.resize(frame_index + n_parameters);
+
+  for (int i=0; i!=n_arguments; ++i) {
+    int parameter_index = parameterIndex(parameter_names,argument_names[i]);
+    stack[frame_index + parameter_index] =
+      std::move(stack[arguments_index + i]);
+  }
+
+  const Any *frame_ptr = stack.data() + frame_index;
+
+  Optional<Object> maybe_object =
+    the_class.maybeMakeObject(
+      Arguments(frame_ptr,frame_ptr + n_parameters),
+      error_stream
+    );
+
+  stack.erase(stack.begin() + arguments_index - n_extra, stack.end());
+
+  if (!maybe_object) {
+    return false;
+  }
+
+  stack.push_back(Any(std::move(*maybe_object)));
+  return true;
+}
+
+
+template <typename Function>
+static bool
+  evaluateFunctionCall(
+    vector<Any> &stack,
+    const Function &function,
+    const ArgumentNames &argument_names,
+    const int n_extra
+  )
+{
+  int n_arguments = argument_names.size();
+  int arguments_index = stack.size() - n_arguments;
+  int n_positional_arguments = 0;
+
+  // Named arguments aren't supported for functions yet, so they are
+  // ignored.  The positional ones are moved together over them in place,
+  // since growing the stack could move the function that we're calling.
+  for (int i=0; i!=n_arguments; ++i) {
+    if (argument_names[i].empty()) {
+      int frame_index = arguments_index + n_positional_arguments;
+
+      if (frame_index!=arguments_index + i) {
+        stack[frame_index] = std::move(stack[arguments_index + i]);
+      }
+
+      ++n_positional_arguments;
+    }
+  }
+
+  const Any *frame_ptr = stack.data() + arguments_index;
+  const Any *frame_end_ptr = frame_ptr + n_positional_arguments;
+  Optional<Any> maybe_result = function(Arguments(frame_ptr,frame_end_ptr));
+
+  stack.erase(stack.begin() + arguments_index - n_extra, stack.end());
+
+  if (!maybe_result) {
+    return false;
+  }
+
+  stack.push_back(std::move(*maybe_result));
+  return true;
+}
+
+
+bool
+  evaluateCallOnStack(
+    vector<Any> &stack,
+    const ArgumentNames &argument_names,
+    ostream &error_stream
+  )
+{
+  int n_arguments = argument_names.size();
+  Any &first_term = *(stack.end() - n_arguments - 1);
+
+  if (first_term.isClassPtr()) {
+    const Class *class_ptr = first_term.asClassPtr();
+    assert(class_ptr);
+    const Class &the_class = *class_ptr;
+
+    return
+      evaluateObjectConstruction(
+        stack, the_class, argument_names, /*n_extra*/1, error_stream
+      );
+  }
+  else if (first_term.isFunction()) {
+    return
+      evaluateFunctionCall(
+        stack, first_term.asFunction(), argument_names, /*n_extra*/1
+      );
+  }
+
+  // We had [term '('], but term wasn't a class or a function.
+  // What type did it have?
+  error_stream << "first_term.typeName():" << first_term.typeName() << "\n";
+  assert(false);
+  return false;
+}
+
+
+bool
+  evaluateMethodCallOnStack(
+    vector<Any> &stack,
+    const Object::Method &method,
+    const ArgumentNames &argument_names
+  )
+{
+  int n_arguments = argument_names.size();
+  const Any &object = *(stack.end() - n_arguments - 1);
+  assert(object.isObject());
+
+  // The data is owned by the object, so it stays put even if the stack
+  // is reallocated.
+  const Object::Data &data = object.asObject().data();
+
+  auto call =
+    [&](const Arguments &parameters){
+      return method.call_ptr(data,parameters);
+    };
+
+  return evaluateFunctionCall(stack, call, argument_names, /*n_extra*/1);
+}
@@ -0,0 +1,56 @@
+#ifndef ANYOPERATIONS_HPP_
+#define ANYOPERATIONS_HPP_
+
+#include <iosfwd>
+#include "optional.hpp"
+#include "any.hpp"
+
+
+// These are the operations that expressions can perform on values.  They
+// are shared by all the ways of evaluating an expression so that the
+// results and error messages are the same.
+
+extern Optional<Any> maybeAdd(const Any &,const Any &,std::ostream &);
+extern Optional<Any> maybeSubtract(const Any &,const Any &,std::ostream &);
+extern Optional<Any> maybeMultiply(const Any &,const Any &,std::ostream &);
+extern Optional<Any> maybeDivide(const Any &,const Any &,std::ostream &);
+
+// Makes a vector from the given elements, which are moved from.  Vectors
+// of floats are packed.
+extern Any
+  makeVectorValue(
+    std::vector<Any>::iterator first,
+    std::vector<Any>::iterator last
+  );
+
+extern Optional<Any>
+  maybeMemberOf(
+    const Any &,
+    const Symbol &member_name,
+    std::ostream &error_stream
+  );
+
+// The names of the arguments of a call, in order.  Positional arguments
+// use the empty symbol.
+using ArgumentNames = std::vector<Symbol>;
+
+// The stack ends with the class or function being called, followed by
+// a value for each argument.  On success, these are replaced by the result.
+extern bool
+  evaluateCallOnStack(
+    std::vector<Any> &stack,
+    const ArgumentNames &argument_names,
+    std::ostream &error_stream
+  );
+
+// This is like evaluateCallOnStack, but the stack ends with the object
+// that the method belongs to instead of a function.
+extern bool
+  evaluateMethodCallOnStack(
+    std::vector<Any> &stack,
+    const Object::Method &method,
+    const ArgumentNames &argument_names
+  );
+
+
+#endif /* ANYOPERATIONS_HPP_ */
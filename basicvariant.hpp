@@ -79,7 +79,9 @@ class BasicVariant : public Policy {
 
     bool operator==(const BasicVariant &arg) const
     {
-      if (this->_type!=arg._type) return false;
+      if (this->_type!=arg._type) {
+        return Policy::differentTypesAreEqual(*this,arg);
+      }
 
       return
         Self::withMemberPtrFor(
@@ -0,0 +1,121 @@
+#include "bodyaccess.hpp"
+
+#include <map>
+#include <algorithm>
+
+using std::vector;
+using Body = Scene::Body;
+
+
+void BodyAccess::addReadBodyAndAncestors(const Body *body_ptr)
+{
+  for (; body_ptr; body_ptr = body_ptr->parentPtr()) {
+    read_body_ptrs.push_back(body_ptr);
+  }
+}
+
+
+void BodyAccess::add(const BodyAccess &arg)
+{
+  if (!arg.is_known) {
+    is_known = false;
+  }
+
+  read_body_ptrs.insert(
+    read_body_ptrs.end(),arg.read_body_ptrs.begin(),arg.read_body_ptrs.end()
+  );
+
+  written_body_ptrs.insert(
+    written_body_ptrs.end(),
+    arg.written_body_ptrs.begin(),
+    arg.written_body_ptrs.end()
+  );
+}
+
+
+static bool
+  haveABodyInCommon(
+    const vector<const Body *> &body_ptrs1,
+    const vector<const Body *> &body_ptrs2
+  )
+{
+  for (const Body *body_ptr : body_ptrs1) {
+    if (std::find(body_ptrs2.begin(),body_ptrs2.end(),body_ptr)!=
+        body_ptrs2.end()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+bool accessesConflict(const BodyAccess &access1,const BodyAccess &access2)
+{
+  if (!access1.is_known || !access2.is_known) {
+    return true;
+  }
+
+  return
+    haveABodyInCommon(access1.written_body_ptrs,access2.read_body_ptrs) ||
+    haveABodyInCommon(access1.written_body_ptrs,access2.written_body_ptrs) ||
+    haveABodyInCommon(access1.read_body_ptrs,access2.written_body_ptrs);
+}
+
+
+vector<vector<int>> accessWaves(const vector<BodyAccess> &accesses)
+{
+  using BodyWaves = std::map<const Body *,int>;
+
+  BodyWaves last_read_waves;
+  BodyWaves last_write_waves;
+  vector<vector<int>> waves;
+  int first_allowed_wave = 0;
+  int n_accesses = accesses.size();
+
+  auto laterThan = [](const BodyWaves &body_waves,const Body *body_ptr){
+    auto iter = body_waves.find(body_ptr);
+    return iter==body_waves.end() ? 0 : iter->second + 1;
+  };
+
+  auto record = [](BodyWaves &body_waves,const Body *body_ptr,int wave){
+    auto iter = body_waves.emplace(body_ptr,wave).first;
+    iter->second = std::max(iter->second,wave);
+  };
+
+  for (int i=0; i!=n_accesses; ++i) {
+    const BodyAccess &access = accesses[i];
+    int wave = first_allowed_wave;
+
+    if (!access.is_known) {
+      wave = std::max(wave,int(waves.size()));
+      first_allowed_wave = wave + 1;
+    }
+    else {
+      for (const Body *body_ptr : access.read_body_ptrs) {
+        wave = std::max(wave,laterThan(last_write_waves,body_ptr));
+      }
+
+      for (const Body *body_ptr : access.written_body_ptrs) {
+        wave = std::max(wave,laterThan(last_write_waves,body_ptr));
+        wave = std::max(wave,laterThan(last_read_waves,body_ptr));
+      }
+    }
+
+    for (const Body *body_ptr : access.read_body_ptrs) {
+      record(last_read_waves,body_ptr,wave);
+    }
+
+    for (const Body *body_ptr : access.written_body_ptrs) {
+      record(last_write_waves,body_ptr,wave);
+    }
+
+    if (wave>=int(waves.size())) {
+      waves.resize(wave+1);
+    }
+
+    waves[wave].push_back(i);
+  }
+
+  return waves;
+}
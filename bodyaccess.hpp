@@ -0,0 +1,39 @@
+#ifndef BODYACCESS_HPP_
+#define BODYACCESS_HPP_
+
+#include <vector>
+#include "scene.hpp"
+
+
+// The bodies that something reads and writes when it is applied, for
+// finding which things can be applied at the same time.
+struct BodyAccess {
+  bool is_known = true;
+    // This is false if it might read or write any body.
+  std::vector<const Scene::Body *> read_body_ptrs;
+  std::vector<const Scene::Body *> written_body_ptrs;
+
+  void addReadBodyAndAncestors(const Scene::Body *body_ptr);
+    // The global position of a body depends on the positions of the
+    // bodies above it.  A null body is ignored.
+
+  void add(const BodyAccess &);
+};
+
+
+// This is false if applying the two in either order gives the same
+// result, since neither one writes a body that the other one uses.
+extern bool accessesConflict(const BodyAccess &,const BodyAccess &);
+
+
+// This groups the accesses into waves which can be applied one after
+// another, where the ones in a wave can be applied at the same time.
+// Each one goes in a later wave than any earlier one that writes a body
+// that it reads or writes, or that reads a body that it writes, so applying
+// the waves gives the same result as applying them in order.  Unknown
+// accesses get a wave of their own.
+extern std::vector<std::vector<int>>
+  accessWaves(const std::vector<BodyAccess> &);
+
+
+#endif /* BODYACCESS_HPP_ */
@@ -0,0 +1,117 @@
+#include "bodyaccess.hpp"
+
+#include <cassert>
+
+using std::vector;
+using Waves = vector<vector<int>>;
+
+
+static BodyAccess
+  access(
+    const vector<const Scene::Body *> &read_body_ptrs,
+    const vector<const Scene::Body *> &written_body_ptrs
+  )
+{
+  BodyAccess result;
+  result.read_body_ptrs = read_body_ptrs;
+  result.written_body_ptrs = written_body_ptrs;
+  return result;
+}
+
+
+static void testIndependentAccesses()
+{
+  Scene scene;
+  const Scene::Body *a = &scene.addBody();
+  const Scene::Body *b = &scene.addBody();
+  const Scene::Body *c = &scene.addBody();
+
+  vector<BodyAccess> accesses = {
+    access({c},{a}),
+    access({c},{b})
+  };
+
+  assert((accessWaves(accesses)==Waves{{0,1}}));
+}
+
+
+static void testDependentAccesses()
+{
+  Scene scene;
+  const Scene::Body *a = &scene.addBody();
+  const Scene::Body *b = &scene.addBody();
+  const Scene::Body *c = &scene.addBody();
+  const Scene::Body *d = &scene.addBody();
+
+  vector<BodyAccess> accesses = {
+    access({a},{b}),
+    access({b},{c}), // reads what 0 writes
+    access({},{d}),
+    access({},{a}),  // writes what 0 reads
+    access({},{c})   // writes what 1 writes
+  };
+
+  assert((accessWaves(accesses)==Waves{{0,2},{1,3},{4}}));
+}
+
+
+static void testReadingAChildOfAWrittenBody()
+{
+  Scene scene;
+  Scene::Body &parent = scene.addBody();
+  const Scene::Body *child = &scene.addChildBodyTo(parent);
+  BodyAccess reader;
+  reader.addReadBodyAndAncestors(child);
+
+  vector<BodyAccess> accesses = {
+    access({},{&parent}),
+    reader
+  };
+
+  assert((accessWaves(accesses)==Waves{{0},{1}}));
+}
+
+
+static void testUnknownAccess()
+{
+  Scene scene;
+  const Scene::Body *a = &scene.addBody();
+  const Scene::Body *b = &scene.addBody();
+  BodyAccess unknown;
+  unknown.is_known = false;
+
+  vector<BodyAccess> accesses = {
+    access({},{a}),
+    unknown,
+    access({},{b})
+  };
+
+  assert((accessWaves(accesses)==Waves{{0},{1},{2}}));
+}
+
+
+static void testConflictingAccesses()
+{
+  Scene scene;
+  const Scene::Body *a = &scene.addBody();
+  const Scene::Body *b = &scene.addBody();
+  const Scene::Body *c = &scene.addBody();
+  BodyAccess unknown;
+  unknown.is_known = false;
+
+  assert(!accessesConflict(access({a},{b}),access({a},{c})));
+  assert(accessesConflict(access({a},{b}),access({b},{c})));
+  assert(accessesConflict(access({a},{b}),access({},{a})));
+  assert(accessesConflict(access({},{b}),access({},{b})));
+  assert(accessesConflict(access({},{}),unknown));
+}
+
+
+int main()
+{
+  testIndependentAccesses();
+  testDependentAccesses();
+  testReadingAChildOfAWrittenBody();
+  testUnknownAccess();
+  testConflictingAccesses();
+}
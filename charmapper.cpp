@@ -1,5 +1,8 @@
 #include "charmapper.hpp"
 
+#include <sstream>
+#include <algorithm>
+#include "threadpool.hpp"
 #include "defaultdiagrams.hpp"
 #include "removefrom.hpp"
 #include "diagramexecutor.hpp"
@@ -13,10 +16,139 @@ using std::make_unique;
 using std::cerr;
 using std::vector;
 using std::unique_ptr;
+using std::ostringstream;
 using MotionPass = Charmapper::MotionPass;
 using VariablePass = Charmapper::VariablePass;
+using PosExpr = Charmapper::MotionPass::PosExpr;
+using GlobalPosition = Charmapper::GlobalPosition;
+using Channel = Charmapper::Channel;
+using Position = Charmapper::Position;
+
+
+namespace {
+struct PosExprStep {
+  PosExpr *expr_ptr;
+  unsigned long global_position_revision;
+  GlobalPosition::ComponentsData *components_ptr;
+  GlobalPosition::FromBodyData *from_body_ptr;
+    // Exactly one of these is set.
+  BodyLink target_body_link;
+    // The body link that the target_body variable was made from.
+  BodyLink source_body_link;
+    // The body link that the source_body variable was made from.
+  DisplayFrames *display_frames_ptr;
+    // The display frames that the body variables were made with.
+  Environment local_position_environment;
+  Environment global_position_environment;
+  Environment pos_expr_environment;
+};
+}
+
+
+namespace {
+// What the body access of a plan was found from, besides what the plan
+// itself already checks.  Links, diagrams and variable names can change
+// without the plan being made again.
+struct BodyAccessInputs {
+  vector<size_t> variable_counts;
+  vector<const Scene::Body *> body_ptrs;
+  vector<unsigned long> schedule_revisions;
+  vector<std::string> variable_names;
+};
+}
+
+
+namespace {
+// This either records the inputs, or checks that they are the same as
+// the ones that were recorded, without allocating.
+struct BodyAccessInputsVisitor {
+  BodyAccessInputs &inputs;
+  const bool is_recording;
+  bool inputs_match = true;
+  size_t n_variable_counts = 0;
+  size_t n_body_ptrs = 0;
+  size_t n_schedule_revisions = 0;
+  size_t n_variable_names = 0;
+
+  template <typename T>
+  void visit(vector<T> &values,size_t &n_values,const T &value)
+  {
+    if (is_recording) {
+      values.push_back(value);
+    }
+    else if (n_values>=values.size() || !(values[n_values]==value)) {
+      inputs_match = false;
+    }
+
+    ++n_values;
+  }
+
+  void visitVariableCount(size_t n_variables)
+  {
+    visit(inputs.variable_counts,n_variable_counts,n_variables);
+  }
+
+  void visitBody(const Scene::Body *body_ptr)
+  {
+    visit(inputs.body_ptrs,n_body_ptrs,body_ptr);
+  }
+
+  void visitDiagram(const Diagram *diagram_ptr)
+  {
+    unsigned long revision =
+      diagram_ptr ? diagram_ptr->schedule().revision : 0;
+
+    visit(inputs.schedule_revisions,n_schedule_revisions,revision);
+  }
+
+  void visitVariableName(const std::string &name)
+  {
+    visit(inputs.variable_names,n_variable_names,name);
+  }
+
+  bool allInputsMatch() const
+  {
+    return
+      inputs_match &&
+      n_variable_counts==inputs.variable_counts.size() &&
+      n_body_ptrs==inputs.body_ptrs.size() &&
+      n_schedule_revisions==inputs.schedule_revisions.size() &&
+      n_variable_names==inputs.variable_names.size();
+  }
+};
+}
+
+
+// The passes flattened into the order that they are applied, with
+// everything that doesn't change from one application to the next already
+// looked up.  Each pos expr keeps its own environments, so they only need
+// their values updated, and the variable lookups in the diagrams keep
+// finding the same layouts.
+struct Charmapper::Plan {
+  struct PassStep {
+    const MotionPass *motion_pass_ptr = nullptr;
+    unsigned long pos_exprs_revision = 0;
+    const VariablePass *variable_pass_ptr = nullptr;
+    int first_pos_expr_step = 0;
+    int n_pos_expr_steps = 0;
+  };
+
+  unsigned long passes_revision = 0;
+  std::vector<PassStep> pass_steps;
+  std::vector<PosExprStep> pos_expr_steps;
+  Class pos_expr_class = posExprClass();
+  Environment charmapper_environment;
+  bool has_body_access = false;
+  BodyAccess body_access;
+  BodyAccessInputs body_access_inputs;
+};
+
+
+Charmapper::Charmapper() = default;
 
 
+Charmapper::~Charmapper() = default;
+
 
 Charmapper::MotionPass::MotionPass()
 {
@@ -45,18 +177,21 @@ static T& insert(vector<unique_ptr<U>> &ptr_vector,size_t index)
 
 auto Charmapper::MotionPass::addPosExpr() -> PosExpr&
 {
+  ++pos_exprs_revision;
   return create<PosExpr>(pos_exprs);
 }
 
 
 MotionPass& Charmapper::addMotionPass()
 {
+  ++passes_revision;
   return create<MotionPass>(passes);
 }
 
 
 VariablePass& Charmapper::addVariablePass()
 {
+  ++passes_revision;
   return create<VariablePass>(passes);
 }
 
@@ -99,6 +234,7 @@ void Charmapper::GlobalPosition::switchToComponents()
 {
   diagram = defaultComponentsDiagram();
   global_position_ptr = std::make_unique<ComponentsData>();
+  ++revision;
 }
 
 
@@ -106,6 +242,7 @@ void Charmapper::GlobalPosition::switchToFromBody()
 {
   diagram = defaultFromBodyDiagram();
   global_position_ptr = std::make_unique<FromBodyData>();
+  ++revision;
 }
 
 
@@ -132,18 +269,23 @@ Charmapper::MotionPass::PosExpr::PosExpr()
 void Charmapper::MotionPass::removePosExpr(int index)
 {
   removeFrom(pos_exprs,pos_exprs[index]);
+  ++pos_exprs_revision;
 }
 
 
 static void
   setDisplayedBodyPosition(
     BodyLink &target_body_link,
-    const Point2D &new_position
+    const Point2D &new_position,
+    DisplayFrames *display_frames_ptr
   )
 {
   Scene::Body &target_body = target_body_link.body();
   Scene &target_scene = target_body_link.scene();
-  Scene::Frame &target_frame = target_scene.displayFrame();
+
+  Scene::Frame &target_frame =
+    displayFrameOf(target_scene,display_frames_ptr);
+
   setBodyPosition(target_body,target_frame,new_position);
 }
 
@@ -152,14 +294,16 @@ static float
   evaluateChannel(
     const Charmapper::Channel &channel,
     const Environment *parent_environment_ptr,
-    AbstractDiagramEvaluator &evaluator
+    AbstractDiagramEvaluator &evaluator,
+    const DiagramExecutionContext &context
   )
 {
   if (channel.optional_diagram) {
     // Seems like we should be setting the expected return value type
     // somewhere.
     Optional<Any> maybe_result =
-      evaluator.maybeEvaluate(
+      evaluator.maybeEvaluateIn(
+        context,
         *channel.optional_diagram,
         parent_environment_ptr,
         Any::floatTypeName()
@@ -182,11 +326,12 @@ static Point2D
   makePoint2D(
     const Charmapper::GlobalPosition::ComponentsData &p,
     const Environment *parent_environment_ptr,
-    AbstractDiagramEvaluator &evaluator
+    AbstractDiagramEvaluator &evaluator,
+    const DiagramExecutionContext &context
   )
 {
-  float x = evaluateChannel(p.x,parent_environment_ptr,evaluator);
-  float y = evaluateChannel(p.y,parent_environment_ptr,evaluator);
+  float x = evaluateChannel(p.x,parent_environment_ptr,evaluator,context);
+  float y = evaluateChannel(p.y,parent_environment_ptr,evaluator,context);
 
   return Point2D(x,y);
 }
@@ -203,11 +348,14 @@ static void
     Diagram &diagram,
     const Environment *parent_environment_ptr,
     Point2D &new_position,
-    AbstractDiagramEvaluator &evaluator
+    AbstractDiagramEvaluator &evaluator,
+    const DiagramExecutionContext &context
   )
 {
   Optional<Any> maybe_return_value =
-    evaluator.maybeEvaluate(diagram,parent_environment_ptr);
+    evaluator.maybeEvaluateIn(
+      context,diagram,parent_environment_ptr,/*optional_expected_type_name*/{}
+    );
 
   if (!maybe_return_value) {
     return;
@@ -262,128 +410,706 @@ MotionPass &Charmapper::motionPass(int pass_index)
 }
 
 
-void Charmapper::apply(AbstractDiagramEvaluator &evaluator)
+bool Charmapper::planIsCurrent(const Plan *plan_ptr) const
+{
+  if (!plan_ptr) {
+    return false;
+  }
+
+  const Plan &plan = *plan_ptr;
+
+  if (plan.passes_revision!=passes_revision) {
+    return false;
+  }
+
+  for (const Plan::PassStep &pass_step : plan.pass_steps) {
+    if (!pass_step.motion_pass_ptr) {
+      continue;
+    }
+
+    const MotionPass &pass = *pass_step.motion_pass_ptr;
+
+    if (pass_step.pos_exprs_revision!=pass.posExprsRevision()) {
+      return false;
+    }
+
+    int first = pass_step.first_pos_expr_step;
+    int end = first + pass_step.n_pos_expr_steps;
+
+    for (int i=first; i!=end; ++i) {
+      const PosExprStep &step = plan.pos_expr_steps[i];
+
+      const GlobalPosition &global_position = step.expr_ptr->global_position;
+
+      if (step.global_position_revision!=global_position.revision) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+auto Charmapper::makePlan() -> unique_ptr<Plan>
 {
-  Environment charmapper_environment(evaluator.context.parent_environment_ptr);
+  unique_ptr<Plan> plan_ptr = make_unique<Plan>();
+  Plan &plan = *plan_ptr;
+  plan.passes_revision = passes_revision;
   int n_passes = nPasses();
+  int n_pos_exprs = 0;
+
+  for (int i=0; i!=n_passes; ++i) {
+    if (MotionPass *motion_pass_ptr = maybeMotionPass(i)) {
+      n_pos_exprs += motion_pass_ptr->nExprs();
+    }
+  }
+
+  // The environments refer to the charmapper environment, so the steps
+  // can't be moved once they are made.
+  plan.pos_expr_steps.reserve(n_pos_exprs);
 
   for (int i=0; i!=n_passes; ++i) {
-    if (auto *motion_pass_ptr = maybeMotionPass(i)) {
-      // Need to extract this to another method.
-      auto &pass = *motion_pass_ptr;
-      auto n_exprs = pass.nExprs();
-
-      for (int i=0; i!=n_exprs; ++i) {
-        MotionPass::PosExpr &expr = pass.expr(i);
-        BodyLink &target_body_link = expr.target_body_link;
-
-        // The diagram generates a PosExpr object, which requires a target body.
-        if (target_body_link.hasValue()) {
-          Point2D global_position(0,0);
-
-          if (expr.global_position.isComponents()) {
-            Diagram &diagram = expr.global_position.diagram;
-            Point2D parameters =
-              makePoint2D(
-                expr.global_position.components(),
-                &charmapper_environment,
-                evaluator
-              );
-
-            Environment environment(&charmapper_environment);
-            environment["x"] = parameters.x;
-            environment["y"] = parameters.y;
-            evaluatePoint2DDiagram(
-              diagram,&environment,global_position,evaluator
-            );
-          }
-          else if (expr.global_position.isFromBody()) {
-            using FromBodyData = GlobalPosition::FromBodyData;
-            FromBodyData &from_body_data = expr.global_position.fromBody();
-            BodyLink &source_body_link = from_body_data.source_body_link;
-
-
-            Diagram &local_position_diagram =
-              from_body_data.local_position.diagram;
-            Point2D local_position(0,0);
-            {
-              float x_param = from_body_data.local_position.x.value;
-              float y_param = from_body_data.local_position.y.value;
-
-              Environment environment(&charmapper_environment);
-              environment["x"] = x_param;
-              environment["y"] = y_param;
-
-              evaluatePoint2DDiagram(
-                local_position_diagram,&environment,local_position,
-                evaluator
-              );
-            }
-            {
-              Environment environment(&charmapper_environment);
-              environment["source_body"] = makeBodyObject(source_body_link);
-              environment["local_position"] = makePoint2DObject(local_position);
-
-              evaluatePoint2DDiagram(
-                expr.global_position.diagram,
-                &environment,
-                global_position,
-                evaluator
-              );
-            }
-          }
-          else {
-            assert(false);
-          }
-
-          Diagram &diagram = expr.diagram;
-          Class pos_expr_class = posExprClass();
-          Point2D local_position = makePoint2D(expr.local_position);
-
-          Environment environment(&charmapper_environment);
-          environment["PosExpr"] = &pos_expr_class;
-          environment["target_body"] = makeBodyObject(target_body_link);
-          environment["local_position"] = makePoint2DObject(local_position);
-          environment["global_position"] = makePoint2DObject(global_position);
-
-          Optional<Any> maybe_return_value =
-            evaluator.maybeEvaluate(
-              diagram,
-              &environment,
-              PosExprObjectData::staticTypeName()
-            );
-
-          Optional<PosExprData> maybe_pos_expr;
-
-          if (maybe_return_value) {
-            maybe_pos_expr =
-              maybePosExpr(*maybe_return_value,evaluator.context.error_stream);
-          }
-          else {
-            evaluator.context.error_stream << "Diagram did not return anything\n";
-          }
-
-          if (maybe_pos_expr) {
-            setDisplayedBodyPosition(
-              maybe_pos_expr->body_link,maybe_pos_expr->position
-            );
-          }
-          else {
-            evaluator.context.error_stream << "pos expr diagram failed\n";
-          }
+    Plan::PassStep pass_step;
+
+    if (MotionPass *motion_pass_ptr = maybeMotionPass(i)) {
+      MotionPass &pass = *motion_pass_ptr;
+      int n_exprs = pass.nExprs();
+      pass_step.motion_pass_ptr = &pass;
+      pass_step.pos_exprs_revision = pass.posExprsRevision();
+      pass_step.first_pos_expr_step = plan.pos_expr_steps.size();
+      pass_step.n_pos_expr_steps = n_exprs;
+
+      for (int j=0; j!=n_exprs; ++j) {
+        PosExpr &expr = pass.expr(j);
+        GlobalPosition &global_position = expr.global_position;
+        const Environment *charmapper_environment_ptr =
+          &plan.charmapper_environment;
+
+        plan.pos_expr_steps.push_back({
+          &expr,
+          global_position.revision,
+          dynamic_cast<GlobalPosition::ComponentsData *>(
+            global_position.global_position_ptr.get()
+          ),
+          dynamic_cast<GlobalPosition::FromBodyData *>(
+            global_position.global_position_ptr.get()
+          ),
+          /*target_body_link*/{},
+          /*source_body_link*/{},
+          /*display_frames_ptr*/nullptr,
+          Environment(charmapper_environment_ptr),
+          Environment(charmapper_environment_ptr),
+          Environment(charmapper_environment_ptr)
+        });
+
+        PosExprStep &step = plan.pos_expr_steps.back();
+        assert(!step.components_ptr != !step.from_body_ptr);
+
+        if (step.components_ptr) {
+          step.global_position_environment["x"] = 0.0f;
+          step.global_position_environment["y"] = 0.0f;
+        }
+        else {
+          step.local_position_environment["x"] = 0.0f;
+          step.local_position_environment["y"] = 0.0f;
+          step.global_position_environment["source_body"] =
+            makeBodyObject(step.source_body_link);
+          step.global_position_environment["local_position"] = Any();
         }
+
+        Environment &environment = step.pos_expr_environment;
+        environment["PosExpr"] = &plan.pos_expr_class;
+        environment["target_body"] = makeBodyObject(step.target_body_link);
+        environment["local_position"] = Any();
+        environment["global_position"] = Any();
       }
     }
-    else if (auto *variable_pass_ptr = maybeVariablePass(i)) {
-      auto &variables = variable_pass_ptr->variables;
+    else if (VariablePass *variable_pass_ptr = maybeVariablePass(i)) {
+      pass_step.variable_pass_ptr = variable_pass_ptr;
+    }
+    else {
+      assert(false);
+    }
+
+    plan.pass_steps.push_back(pass_step);
+  }
+
+  ++n_plans_made;
+  return plan_ptr;
+}
+
+
+auto Charmapper::currentPlan(int plan_index) -> Plan &
+{
+  // Threads that apply the charmapper at the same time look up their
+  // plans at the same time.
+  std::lock_guard<std::mutex> lock(plan_ptrs_mutex);
+
+  if (plan_index>=int(plan_ptrs.size())) {
+    plan_ptrs.resize(plan_index + 1);
+  }
+
+  unique_ptr<Plan> &plan_ptr = plan_ptrs[plan_index];
+
+  if (!planIsCurrent(plan_ptr.get())) {
+    plan_ptr = makePlan();
+  }
+
+  return *plan_ptr;
+}
+
+
+static void
+  updateBodyObject(
+    Any &body_object,
+    BodyLink &current_body_link,
+    const BodyLink &new_body_link,
+    DisplayFrames *display_frames_ptr
+  )
+{
+  if (current_body_link==new_body_link) {
+    return;
+  }
+
+  current_body_link = new_body_link;
+  body_object = makeBodyObject(new_body_link,display_frames_ptr);
+}
+
+
+static void
+  applyPosExpr(
+    PosExprStep &step,
+    AbstractDiagramEvaluator &evaluator,
+    const DiagramExecutionContext &context,
+    DisplayFrames *display_frames_ptr
+  )
+{
+  PosExpr &expr = *step.expr_ptr;
+  BodyLink &target_body_link = expr.target_body_link;
+
+  // The diagram generates a PosExpr object, which requires a target body.
+  if (!target_body_link.hasValue()) {
+    return;
+  }
+
+  if (step.display_frames_ptr!=display_frames_ptr) {
+    // The body variables have to be made again to find the body positions
+    // in the new display frames.
+    step.display_frames_ptr = display_frames_ptr;
+    step.target_body_link.clear();
+    step.source_body_link.clear();
+  }
+
+  Point2D global_position(0,0);
+
+  if (step.components_ptr) {
+    Environment &environment = step.global_position_environment;
+
+    Point2D parameters =
+      makePoint2D(
+        *step.components_ptr,
+        environment.parent_environment_ptr,
+        evaluator,
+        context
+      );
+
+    environment["x"] = parameters.x;
+    environment["y"] = parameters.y;
+
+    evaluatePoint2DDiagram(
+      expr.global_position.diagram,&environment,global_position,evaluator,
+      context
+    );
+  }
+  else {
+    GlobalPosition::FromBodyData &from_body_data = *step.from_body_ptr;
+    Point2D local_position(0,0);
+    {
+      Environment &environment = step.local_position_environment;
+      environment["x"] = float(from_body_data.local_position.x.value);
+      environment["y"] = float(from_body_data.local_position.y.value);
+
+      evaluatePoint2DDiagram(
+        from_body_data.local_position.diagram,&environment,local_position,
+        evaluator,context
+      );
+    }
+    {
+      Environment &environment = step.global_position_environment;
+
+      updateBodyObject(
+        environment["source_body"],
+        step.source_body_link,
+        from_body_data.source_body_link,
+        display_frames_ptr
+      );
+
+      environment["local_position"] = makePoint2DObject(local_position);
+
+      evaluatePoint2DDiagram(
+        expr.global_position.diagram,
+        &environment,
+        global_position,
+        evaluator,
+        context
+      );
+    }
+  }
+
+  Point2D local_position = makePoint2D(expr.local_position);
+  Environment &environment = step.pos_expr_environment;
+
+  updateBodyObject(
+    environment["target_body"],
+    step.target_body_link,
+    target_body_link,
+    display_frames_ptr
+  );
+
+  environment["local_position"] = makePoint2DObject(local_position);
+  environment["global_position"] = makePoint2DObject(global_position);
+
+  Optional<Any> maybe_return_value =
+    evaluator.maybeEvaluateIn(
+      context,
+      expr.diagram,
+      &environment,
+      PosExprObjectData::staticTypeName()
+    );
+
+  Optional<PosExprData> maybe_pos_expr;
+
+  if (maybe_return_value) {
+    maybe_pos_expr =
+      maybePosExpr(*maybe_return_value,context.error_stream);
+  }
+  else {
+    context.error_stream << "Diagram did not return anything\n";
+  }
+
+  if (maybe_pos_expr) {
+    setDisplayedBodyPosition(
+      maybe_pos_expr->body_link,maybe_pos_expr->position,display_frames_ptr
+    );
+  }
+  else {
+    context.error_stream << "pos expr diagram failed\n";
+  }
+}
+
+
+static bool contains(const vector<Symbol> &names,const Symbol &name)
+{
+  return std::find(names.begin(),names.end(),name)!=names.end();
+}
+
+
+static bool
+  diagramOnlyUsesKnownNames(
+    const Diagram &diagram,
+    const vector<Symbol> &parameter_names,
+    const vector<Symbol> &variable_names
+  )
+{
+  const Diagram::Schedule &schedule = diagram.schedule();
+  vector<Symbol> assigned_names;
+
+  for (const Diagram::Schedule::Statement &statement : schedule.statements) {
+    const CompiledStatement &compiled = *statement.compiled_ptr;
+
+    if (compiled.type==CompiledStatement::Type::assignment) {
+      assigned_names.push_back(compiled.variable_name);
+    }
+  }
+
+  // Charmapper variables only hold numbers.
+  auto isKnown = [&](const Symbol &name){
+    return
+      contains(parameter_names,name) ||
+      contains(assigned_names,name) ||
+      contains(variable_names,name);
+  };
+
+  for (const Diagram::Schedule::Statement &statement : schedule.statements) {
+    for (auto &variable : statement.compiled_ptr->expression.variables) {
+      if (!isKnown(variable.name)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
 
-      for (auto &variable : variables) {
+// The access is unknown if the diagrams use names that might refer to other
+// bodies, like the names of scenes.
+static BodyAccess
+  posExprAccess(
+    const PosExprStep &step,
+    const vector<Symbol> &variable_names
+  )
+{
+  static const vector<Symbol> no_names;
+  static const vector<Symbol> xy_names = {Symbol("x"),Symbol("y")};
+
+  static const vector<Symbol> from_body_names = {
+    Symbol("source_body"),Symbol("local_position")
+  };
+
+  static const vector<Symbol> pos_expr_names = {
+    Symbol("PosExpr"),
+    Symbol("target_body"),
+    Symbol("local_position"),
+    Symbol("global_position")
+  };
+
+  const PosExpr &expr = *step.expr_ptr;
+  const Diagram &global_position_diagram = expr.global_position.diagram;
+  BodyAccess access;
+
+  auto checkNames = [&](const Diagram &diagram,const vector<Symbol> &names){
+    if (!diagramOnlyUsesKnownNames(diagram,names,variable_names)) {
+      access.is_known = false;
+    }
+  };
+
+  // The pos expr diagram can only get to the target body, so that is the
+  // only body that the PosExpr it returns can be for.
+  checkNames(expr.diagram,pos_expr_names);
+  const Scene::Body *target_body_ptr = expr.target_body_link.bodyPtr();
+  access.addReadBodyAndAncestors(target_body_ptr);
+
+  if (target_body_ptr) {
+    access.written_body_ptrs.push_back(target_body_ptr);
+  }
+
+  if (step.components_ptr) {
+    checkNames(global_position_diagram,xy_names);
+
+    const GlobalPosition::ComponentsData &components = *step.components_ptr;
+
+    for (const Charmapper::Channel *channel_ptr :
+         {&components.x,&components.y}) {
+      if (channel_ptr->optional_diagram) {
+        checkNames(*channel_ptr->optional_diagram,no_names);
+      }
+    }
+  }
+  else {
+    const GlobalPosition::FromBodyData &from_body_data = *step.from_body_ptr;
+    checkNames(from_body_data.local_position.diagram,xy_names);
+    checkNames(global_position_diagram,from_body_names);
+
+    access.addReadBodyAndAncestors(
+      from_body_data.source_body_link.bodyPtr()
+    );
+  }
+
+  return access;
+}
+
+
+static vector<Symbol> slotNames(const EnvironmentLayout &layout)
+{
+  vector<Symbol> names;
+  int n_slots = layout.nSlots();
+
+  for (int i=0; i!=n_slots; ++i) {
+    names.push_back(layout.slotName(i));
+  }
+
+  return names;
+}
+
+
+static void
+  applyPosExprsInWaves(
+    PosExprStep *steps,
+    int n_steps,
+    const Environment &charmapper_environment,
+    AbstractDiagramEvaluator &evaluator,
+    DisplayFrames *display_frames_ptr,
+    ThreadPool &thread_pool
+  )
+{
+  vector<Symbol> variable_names = slotNames(charmapper_environment.layout());
+  vector<BodyAccess> accesses;
+
+  for (int i=0; i!=n_steps; ++i) {
+    accesses.push_back(posExprAccess(steps[i],variable_names));
+  }
+
+  // Each pos expr writes to its own streams, which are copied to the real
+  // ones afterwards in the order of the pos exprs.
+  const DiagramExecutionContext &context = evaluator.context;
+  bool streams_are_same = (&context.show_stream==&context.error_stream);
+  vector<ostringstream> show_streams(n_steps);
+  vector<ostringstream> error_streams(streams_are_same ? 0 : n_steps);
+
+  for (const vector<int> &wave : accessWaves(accesses)) {
+    thread_pool.run(wave.size(),[&](int task_index,int /*thread_index*/){
+      int i = wave[task_index];
+      std::ostream &show_stream = show_streams[i];
+
+      std::ostream &error_stream =
+        streams_are_same ? show_stream : error_streams[i];
+
+      DiagramExecutionContext
+        step_context{show_stream,error_stream,context.parent_environment_ptr};
+
+      applyPosExpr(steps[i],evaluator,step_context,display_frames_ptr);
+    });
+  }
+
+  for (int i=0; i!=n_steps; ++i) {
+    context.show_stream << show_streams[i].str();
+
+    if (!streams_are_same) {
+      context.error_stream << error_streams[i].str();
+    }
+  }
+}
+
+
+static bool channelUsesDiagram(const Channel &channel,const Diagram &diagram)
+{
+  return channel.optional_diagram && &*channel.optional_diagram==&diagram;
+}
+
+
+static bool
+  positionUsesDiagram(const Position &position,const Diagram &diagram)
+{
+  return
+    &position.diagram==&diagram ||
+    channelUsesDiagram(position.x,diagram) ||
+    channelUsesDiagram(position.y,diagram);
+}
+
+
+static bool
+  globalPositionUsesDiagram(
+    const GlobalPosition &global_position,
+    const Diagram &diagram
+  )
+{
+  if (&global_position.diagram==&diagram) {
+    return true;
+  }
+
+  const GlobalPosition::Data *data_ptr =
+    global_position.global_position_ptr.get();
+
+  if (auto from_body_ptr =
+      dynamic_cast<const GlobalPosition::FromBodyData *>(data_ptr)) {
+    return positionUsesDiagram(from_body_ptr->local_position,diagram);
+  }
+
+  if (auto components_ptr =
+      dynamic_cast<const GlobalPosition::ComponentsData *>(data_ptr)) {
+    return
+      channelUsesDiagram(components_ptr->x,diagram) ||
+      channelUsesDiagram(components_ptr->y,diagram);
+  }
+
+  return false;
+}
+
+
+static bool
+  variableUsesDiagram(
+    const Charmapper::Variable &variable,
+    const Diagram &diagram
+  )
+{
+  return
+    channelUsesDiagram(variable.value,diagram) ||
+    (variable.maybe_minimum &&
+      channelUsesDiagram(*variable.maybe_minimum,diagram)) ||
+    (variable.maybe_maximum &&
+      channelUsesDiagram(*variable.maybe_maximum,diagram));
+}
+
+
+bool Charmapper::usesDiagram(const Diagram &diagram) const
+{
+  int n_passes = nPasses();
+
+  for (int pass_index=0; pass_index!=n_passes; ++pass_index) {
+    if (const MotionPass *motion_pass_ptr = maybeMotionPass(pass_index)) {
+      int n_exprs = motion_pass_ptr->nExprs();
+
+      for (int expr_index=0; expr_index!=n_exprs; ++expr_index) {
+        const PosExpr &expr = motion_pass_ptr->expr(expr_index);
+
+        if (&expr.diagram==&diagram ||
+            positionUsesDiagram(expr.local_position,diagram) ||
+            globalPositionUsesDiagram(expr.global_position,diagram)) {
+          return true;
+        }
+      }
+    }
+
+    const VariablePass *variable_pass_ptr = maybeVariablePass(pass_index);
+
+    if (variable_pass_ptr) {
+      for (auto &variable : variable_pass_ptr->variables) {
+        if (variableUsesDiagram(variable,diagram)) {
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+
+static const Diagram *maybeDiagramOf(const Channel &channel)
+{
+  return channel.optional_diagram ? &*channel.optional_diagram : nullptr;
+}
+
+
+static void
+  visitBodyAccessInputs(
+    const Charmapper &charmapper,
+    const vector<PosExprStep> &pos_expr_steps,
+    BodyAccessInputsVisitor &visitor
+  )
+{
+  int n_passes = charmapper.nPasses();
+
+  for (int i=0; i!=n_passes; ++i) {
+    const VariablePass *variable_pass_ptr = charmapper.maybeVariablePass(i);
+
+    if (variable_pass_ptr) {
+      visitor.visitVariableCount(variable_pass_ptr->variables.size());
+
+      for (auto &variable : variable_pass_ptr->variables) {
+        visitor.visitVariableName(variable.name);
+      }
+    }
+  }
+
+  for (const PosExprStep &step : pos_expr_steps) {
+    const PosExpr &expr = *step.expr_ptr;
+    visitor.visitBody(expr.target_body_link.bodyPtr());
+    visitor.visitDiagram(&expr.diagram);
+    visitor.visitDiagram(&expr.global_position.diagram);
+
+    if (step.components_ptr) {
+      visitor.visitDiagram(maybeDiagramOf(step.components_ptr->x));
+      visitor.visitDiagram(maybeDiagramOf(step.components_ptr->y));
+    }
+    else {
+      visitor.visitBody(step.from_body_ptr->source_body_link.bodyPtr());
+      visitor.visitDiagram(&step.from_body_ptr->local_position.diagram);
+    }
+  }
+}
+
+
+const BodyAccess &Charmapper::bodyAccess()
+{
+  Plan &plan = currentPlan(/*plan_index*/0);
+
+  if (plan.has_body_access) {
+    BodyAccessInputsVisitor
+      checker{plan.body_access_inputs,/*is_recording*/false};
+
+    visitBodyAccessInputs(*this,plan.pos_expr_steps,checker);
+
+    if (checker.allInputsMatch()) {
+      return plan.body_access;
+    }
+  }
+
+  plan.body_access_inputs = BodyAccessInputs();
+  BodyAccessInputsVisitor
+    recorder{plan.body_access_inputs,/*is_recording*/true};
+
+  visitBodyAccessInputs(*this,plan.pos_expr_steps,recorder);
+  BodyAccess access;
+  vector<Symbol> variable_names;
+
+  for (const Plan::PassStep &pass_step : plan.pass_steps) {
+    if (pass_step.variable_pass_ptr) {
+      for (auto &variable : pass_step.variable_pass_ptr->variables) {
+        if (!contains(variable_names,Symbol(variable.name))) {
+          variable_names.push_back(Symbol(variable.name));
+        }
+      }
+
+      continue;
+    }
+
+    int first = pass_step.first_pos_expr_step;
+    int n_steps = pass_step.n_pos_expr_steps;
+
+    for (int i=first; i!=first+n_steps; ++i) {
+      access.add(posExprAccess(plan.pos_expr_steps[i],variable_names));
+    }
+  }
+
+  plan.body_access = std::move(access);
+  plan.has_body_access = true;
+  ++n_body_accesses_made;
+  return plan.body_access;
+}
+
+
+void
+  Charmapper::apply(
+    AbstractDiagramEvaluator &evaluator,
+    DisplayFrames *display_frames_ptr,
+    int plan_index
+  )
+{
+  Plan &plan = currentPlan(plan_index);
+
+  // Each application starts with only the variables from the context.
+  // Adding the same variables in the same order gives the same layout
+  // again.
+  Environment &charmapper_environment = plan.charmapper_environment;
+  charmapper_environment.parent_environment_ptr =
+    evaluator.context.parent_environment_ptr;
+  charmapper_environment.layout_ptr = &EnvironmentLayout::empty();
+  charmapper_environment.slot_values.clear();
+
+  for (const Plan::PassStep &pass_step : plan.pass_steps) {
+    if (pass_step.variable_pass_ptr) {
+      for (auto &variable : pass_step.variable_pass_ptr->variables) {
         // We'll want to handle diagrams here also
         charmapper_environment[variable.name] = variable.value.value;
       }
+
+      continue;
     }
-    else {
-      assert(false);
+
+    int first = pass_step.first_pos_expr_step;
+    int n_steps = pass_step.n_pos_expr_steps;
+    ThreadPool *thread_pool_ptr = evaluator.thread_pool_ptr;
+
+    if (thread_pool_ptr && thread_pool_ptr->nThreads()>1 && n_steps>1) {
+      applyPosExprsInWaves(
+        &plan.pos_expr_steps[first],
+        n_steps,
+        charmapper_environment,
+        evaluator,
+        display_frames_ptr,
+        *thread_pool_ptr
+      );
+
+      continue;
+    }
+
+    for (int i=first; i!=first+n_steps; ++i) {
+      applyPosExpr(
+        plan.pos_expr_steps[i],evaluator,evaluator.context,display_frames_ptr
+      );
     }
   }
 }
@@ -392,10 +1118,12 @@ void Charmapper::apply(AbstractDiagramEvaluator &evaluator)
 void Charmapper::removePass(int pass_index)
 {
   passes.erase(passes.begin()+pass_index);
+  ++passes_revision;
 }
 
 
 void Charmapper::insertVariablePass(int pass_index)
 {
   insert<VariablePass>(passes,pass_index);
+  ++passes_revision;
 }
@@ -2,10 +2,13 @@
 #define CHARMAPPER_HPP_
 
 #include <vector>
+#include <mutex>
 #include <cassert>
 #include "diagram.hpp"
 #include "scene.hpp"
 #include "bodylink.hpp"
+#include "bodyaccess.hpp"
+#include "displayframes.hpp"
 #include "diagramexecutioncontext.hpp"
 #include "abstractdiagramevaluator.hpp"
 
@@ -16,10 +19,37 @@ class Charmapper {
     struct MotionPass;
     struct VariablePass;
 
-    Charmapper() = default;
+    Charmapper();
     Charmapper(const Charmapper &) = delete;
-
-    void apply(AbstractDiagramEvaluator &evaluator);
+    ~Charmapper();
+
+    void
+      apply(
+        AbstractDiagramEvaluator &evaluator,
+        DisplayFrames *display_frames_ptr = nullptr,
+        int plan_index = 0
+      );
+      // The passes are turned into a plan the first time they are
+      // applied, and the plan is reused until passes or pos exprs are
+      // added or removed, or a global position is switched.  The bodies
+      // are positioned in the given display frames, or the display frames
+      // of their scenes if there aren't any.  Each plan index has its own
+      // plan, so the charmapper can be applied on several threads at the
+      // same time if each one uses a different index.
+
+    const BodyAccess &bodyAccess();
+      // The bodies that applying the charmapper reads and writes, so
+      // that charmappers which don't share bodies can be applied at the
+      // same time.  This is kept with the plan, and only found again when
+      // a body link, a diagram or a variable name has changed.
+
+    int nBodyAccessesMade() const { return n_body_accesses_made; }
+
+    bool usesDiagram(const Diagram &) const;
+      // This is true if the diagram belongs to one of the passes, so
+      // changing it can change what applying the charmapper does.
+
+    int nPlansMade() const { return n_plans_made; }
     int nPasses() const { return passes.size(); }
     MotionPass *maybeMotionPass(int pass_index);
     VariablePass *maybeVariablePass(int pass_index);
@@ -55,6 +85,9 @@ class Charmapper {
       struct Data;
       Diagram diagram;
       std::unique_ptr<Data> global_position_ptr;
+      unsigned long revision = 0;
+        // This changes each time we switch between components and from
+        // body.
 
       GlobalPosition();
 
@@ -163,14 +196,24 @@ class Charmapper {
         return *pos_exprs[index];
       }
 
+      const PosExpr &expr(int index) const
+      {
+        assert(pos_exprs[index]);
+        return *pos_exprs[index];
+      }
+
       int nExprs() const { return pos_exprs.size(); }
 
       PosExpr& addPosExpr();
 
       void removePosExpr(int index);
 
+      unsigned long posExprsRevision() const { return pos_exprs_revision; }
+        // This changes each time a pos expr is added or removed.
+
       private:
         std::vector<std::unique_ptr<PosExpr>> pos_exprs;
+        unsigned long pos_exprs_revision = 0;
 
     };
 
@@ -201,7 +244,18 @@ class Charmapper {
     };
 
   private:
+    struct Plan;
+
     std::vector<std::unique_ptr<Pass>> passes;
+    unsigned long passes_revision = 0;
+    std::vector<std::unique_ptr<Plan>> plan_ptrs;
+    std::mutex plan_ptrs_mutex;
+    int n_plans_made = 0;
+    int n_body_accesses_made = 0;
+
+    bool planIsCurrent(const Plan *) const;
+    std::unique_ptr<Plan> makePlan();
+    Plan &currentPlan(int plan_index);
 };
 
 #endif /* CHARMAPPER_HPP_ */
@@ -1,11 +1,15 @@
 #include "charmapper.hpp"
 
 #include <iostream>
+#include <sstream>
 #include "testdiagramevaluator.hpp"
+#include "threadpool.hpp"
 
 using std::cerr;
 using std::string;
 using std::map;
+using std::vector;
+using std::ostringstream;
 
 
 static map<const Diagram *,DiagramEvaluationState>
@@ -223,6 +227,181 @@ static void testPosExprDiagramWithWrongReturnType()
 }
 
 
+static void testReusingThePlan()
+{
+  Scene scene;
+  auto &body1 = scene.addBody();
+  auto &body2 = scene.addBody();
+  Charmapper charmapper;
+  auto &motion_pass = charmapper.addMotionPass();
+  auto &pos_expr = motion_pass.addPosExpr();
+  pos_expr.target_body_link = BodyLink(&scene,&body1);
+  pos_expr.global_position.components().x.value = 15;
+  applyCharmapper(charmapper);
+  applyCharmapper(charmapper);
+  assert(charmapper.nPlansMade()==1);
+  assert(body1.position_map.x(scene.displayFrame())==15);
+
+  // Values and body links are read each time the plan is applied.
+  pos_expr.global_position.components().x.value = 20;
+  pos_expr.target_body_link = BodyLink(&scene,&body2);
+  applyCharmapper(charmapper);
+  assert(charmapper.nPlansMade()==1);
+  assert(body2.position_map.x(scene.displayFrame())==20);
+
+  pos_expr.global_position.switchToFromBody();
+  pos_expr.global_position.fromBody().source_body_link =
+    BodyLink(&scene,&body1);
+  pos_expr.global_position.fromBody().local_position.x.value = 5;
+  applyCharmapper(charmapper);
+  assert(charmapper.nPlansMade()==2);
+  assert(body2.position_map.x(scene.displayFrame())==20);
+
+  motion_pass.addPosExpr();
+  charmapper.insertVariablePass(0);
+  applyCharmapper(charmapper);
+  assert(charmapper.nPlansMade()==3);
+  applyCharmapper(charmapper);
+  assert(charmapper.nPlansMade()==3);
+}
+
+
+static void testReusingTheBodyAccess()
+{
+  Scene scene;
+  auto &body1 = scene.addBody();
+  auto &body2 = scene.addBody();
+  Charmapper charmapper;
+  auto &motion_pass = charmapper.addMotionPass();
+  auto &pos_expr = motion_pass.addPosExpr();
+  pos_expr.target_body_link = BodyLink(&scene,&body1);
+  const BodyAccess *access_ptr = &charmapper.bodyAccess();
+  assert(access_ptr->written_body_ptrs==vector<const Scene::Body*>{&body1});
+  assert(&charmapper.bodyAccess()==access_ptr);
+  assert(charmapper.nBodyAccessesMade()==1);
+
+  pos_expr.target_body_link = BodyLink(&scene,&body2);
+  assert(charmapper.bodyAccess().written_body_ptrs==
+    vector<const Scene::Body*>{&body2});
+  assert(charmapper.nBodyAccessesMade()==2);
+
+  pos_expr.diagram.createNodeWithText("x");
+  assert(!charmapper.bodyAccess().is_known);
+  assert(charmapper.nBodyAccessesMade()==3);
+  charmapper.bodyAccess();
+  assert(charmapper.nBodyAccessesMade()==3);
+}
+
+
+static vector<Point2D>
+  applyPosExprsWithDependencies(ThreadPool *thread_pool_ptr,string &show_text)
+{
+  Scene scene;
+  vector<Scene::Body *> body_ptrs;
+
+  for (int i=0; i!=5; ++i) {
+    body_ptrs.push_back(&scene.addBody());
+  }
+
+  setBodyPosition(*body_ptrs[0],scene.displayFrame(),Point2D(10,0));
+  Charmapper charmapper;
+  auto &motion_pass = charmapper.addMotionPass();
+
+  auto addFromBody = [&](int target_index,int source_index){
+    auto &pos_expr = motion_pass.addPosExpr();
+    pos_expr.target_body_link = BodyLink(&scene,body_ptrs[target_index]);
+    pos_expr.global_position.switchToFromBody();
+    auto &from_body = pos_expr.global_position.fromBody();
+    from_body.source_body_link.set(&scene,body_ptrs[source_index]);
+    from_body.local_position.x.value = 1;
+  };
+
+  auto addComponents = [&](int target_index,int x){
+    auto &pos_expr = motion_pass.addPosExpr();
+    pos_expr.target_body_link = BodyLink(&scene,body_ptrs[target_index]);
+    pos_expr.global_position.components().x.value = x;
+    pos_expr.global_position.diagram.createNodeWithText("show(x)");
+  };
+
+  addFromBody(/*target*/1,/*source*/0);
+  addFromBody(/*target*/2,/*source*/1);
+  addComponents(/*target*/3,/*x*/7);
+  addComponents(/*target*/4,/*x*/8);
+  addComponents(/*target*/0,/*x*/100);
+
+  ostringstream show_stream;
+  DiagramExecutionContext context{show_stream,/*error_stream*/show_stream};
+  TestDiagramEvaluator evaluator(context);
+  evaluator.thread_pool_ptr = thread_pool_ptr;
+  charmapper.apply(evaluator);
+  show_text = show_stream.str();
+  vector<Point2D> positions;
+
+  for (Scene::Body *body_ptr : body_ptrs) {
+    positions.push_back(bodyPosition(*body_ptr,scene.displayFrame()));
+  }
+
+  return positions;
+}
+
+
+static void testApplyingPosExprsAtTheSameTime()
+{
+  string serial_show_text;
+
+  vector<Point2D> serial_positions =
+    applyPosExprsWithDependencies(/*thread_pool_ptr*/nullptr,serial_show_text);
+
+  assert(serial_positions[0]==Point2D(100,0));
+  assert(serial_positions[1]==Point2D(11,0));
+  assert(serial_positions[2]==Point2D(12,0));
+  assert(serial_positions[3]==Point2D(7,0));
+  assert(serial_positions[4]==Point2D(8,0));
+  assert(serial_show_text!="");
+
+  ThreadPool thread_pool(3);
+
+  for (int i=0; i!=10; ++i) {
+    string parallel_show_text;
+
+    vector<Point2D> parallel_positions =
+      applyPosExprsWithDependencies(&thread_pool,parallel_show_text);
+
+    assert(parallel_positions==serial_positions);
+    assert(parallel_show_text==serial_show_text);
+  }
+}
+
+
+static void testDefaultDiagramsAreShared()
+{
+  using PosExpr = Charmapper::MotionPass::PosExpr;
+  Scene scene;
+  auto &body = scene.addBody();
+  Charmapper charmapper;
+  auto &motion_pass = charmapper.addMotionPass();
+  PosExpr &pos_expr1 = motion_pass.addPosExpr();
+  PosExpr &pos_expr2 = motion_pass.addPosExpr();
+  pos_expr1.target_body_link = BodyLink(&scene,&body);
+  pos_expr2.target_body_link = BodyLink(&scene,&body);
+  applyCharmapper(charmapper);
+
+  const Diagram &default_diagram = PosExpr::defaultDiagram();
+  assert(pos_expr1.diagram.sharesNodesWith(default_diagram));
+  assert(pos_expr2.diagram.sharesNodesWith(default_diagram));
+  assert(
+    pos_expr2.global_position.diagram.sharesNodesWith(
+      pos_expr1.global_position.diagram
+    )
+  );
+
+  clearDiagram(pos_expr1.diagram);
+  assert(!pos_expr1.diagram.sharesNodesWith(default_diagram));
+  assert(pos_expr2.diagram.sharesNodesWith(default_diagram));
+  assert(default_diagram.nExistingNodes()!=0);
+}
+
+
 int main()
 {
   testWithTargetBody();
@@ -238,4 +417,8 @@ int main()
   testGlobalPositionDiagram("return [[],2]",/*expected_x*/0);
   testGlobalPositionDiagram("return [1,[]]",/*expected_x*/0);
   testPosExprDiagramWithWrongReturnType();
+  testDefaultDiagramsAreShared();
+  testReusingThePlan();
+  testReusingTheBodyAccess();
+  testApplyingPosExprsAtTheSameTime();
 }
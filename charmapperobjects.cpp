@@ -11,46 +11,48 @@ using std::make_unique;
 using std::ostream;
 
 
+namespace {
+enum PosExprParameter {
+  body_parameter,
+  pos_parameter
+};
+}
+
+
 static Optional<Object>
   maybeMakePosExprObject(
-    const Class::NamedParameters &named_parameters,
+    const Arguments &parameters,
     ostream &error_stream
   )
 {
   BodyLink body_link;
   Optional<Point2D> maybe_position;
+  const Any &body_value = parameters[body_parameter];
+  const Any &pos_value = parameters[pos_parameter];
 
-  for (auto &named_parameter : named_parameters) {
-    const string &name = named_parameter.first;
-    const Any &value = named_parameter.second;
+  if (!body_value.isVoid()) {
+    if (!body_value.isObject()) {
+      error_stream << "Body parameter is not a body.\n";
+      return {};
+    }
+
+    auto body_object_data_ptr =
+      dynamic_cast<const BodyObjectData*>(&body_value.asObject().data());
 
-    if (name=="body") {
-      if (!value.isObject()) {
-        error_stream << "Body parameter is not a body.\n";
-        return {};
-      }
+    if (!body_object_data_ptr) {
+      assert(false);
+    }
 
-      auto body_object_data_ptr =
-        dynamic_cast<const BodyObjectData*>(&value.asObject().data());
+    body_link = body_object_data_ptr->body_link;
+    assert(body_link.hasValue());
+  }
 
-      if (!body_object_data_ptr) {
-        assert(false);
-      }
+  if (!pos_value.isVoid()) {
+    maybe_position = maybePoint2D(pos_value);
 
-      body_link = body_object_data_ptr->body_link;
-      assert(body_link.hasValue());
-    }
-    else if (name=="pos") {
-      maybe_position = maybePoint2D(value);
-
-      if (!maybe_position) {
-        error_stream << "Could't make the position\n";
-        error_stream << "value.type: " << value.typeName() << "\n";
-        return {};
-      }
-    }
-    else {
-      error_stream << "Unknown parameter '" << name << "'\n";
+    if (!maybe_position) {
+      error_stream << "Could't make the position\n";
+      error_stream << "value.type: " << pos_value.typeName() << "\n";
       return {};
     }
   }
@@ -73,7 +75,13 @@ static Optional<Object>
 
 Class posExprClass()
 {
-  return Class(maybeMakePosExprObject);
+  // These are in the same order as PosExprParameter.
+  static const std::vector<Symbol> parameter_names = {
+    Symbol("body"),
+    Symbol("pos")
+  };
+
+  return Class(parameter_names,maybeMakePosExprObject);
 }
 
 
@@ -97,15 +105,18 @@ Optional<PosExprData> maybePosExpr(const Any &result,ostream &error_stream)
 }
 
 
-Any PosExprObjectData::member(const std::string &member_name) const
+Any PosExprObjectData::member(const Symbol &member_name) const
 {
-  if (member_name=="body") {
+  static const Symbol body_symbol("body");
+  static const Symbol position_symbol("position");
+
+  if (member_name==body_symbol) {
     Object body_link_object(std::make_unique<BodyLinkObjectData>(body_link));
     body_link_object.data();
     return Any(std::move(body_link_object));
   }
 
-  if (member_name=="position") {
+  if (member_name==position_symbol) {
     return makePoint2DObject(position);
   }
 
@@ -119,9 +130,12 @@ std::vector<std::string> BodyLinkObjectData::memberNames() const
 }
 
 
-Any BodyLinkObjectData::member(const std::string &member_name) const
+Any BodyLinkObjectData::member(const Symbol &member_name) const
 {
-  if (member_name=="scene_name") {
+  static const Symbol scene_name_symbol("scene_name");
+  static const Symbol body_name_symbol("body_name");
+
+  if (member_name==scene_name_symbol) {
     if (hasValue()) {
       std::ostringstream stream;
       stream << "Scene(" << &scene() << ")";
@@ -132,9 +146,9 @@ Any BodyLinkObjectData::member(const std::string &member_name) const
     }
   }
 
-  if (member_name=="body_name") {
+  if (member_name==body_name_symbol) {
     if (hasValue()) {
-      return body().name;
+      return body().name();
     }
     else {
       return Any();
@@ -22,7 +22,7 @@ struct BodyLinkObjectData : Object::Data, BodyLink {
     return "BodyLink";
   }
 
-  Any member(const std::string &member_name) const override;
+  Any member(const Symbol &member_name) const override;
 
   std::vector<std::string> memberNames() const override;
 };
@@ -50,7 +50,7 @@ struct PosExprObjectData : Object::Data, PosExprData {
     return new PosExprObjectData(*this);
   }
 
-  Any member(const std::string &member_name) const override;
+  Any member(const Symbol &member_name) const override;
 
   std::vector<std::string> memberNames() const override
   {
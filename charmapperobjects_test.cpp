@@ -76,8 +76,8 @@ static void testMakingPosExprWhenBodyParameterIsNotABody()
 {
   string expected_error_string = "Body parameter is not a body.\n";
 
-  Class::NamedParameters parameters;
-  parameters["body"] = 5;
+  std::vector<Any> parameters(posExprClass().parameterNames().size());
+  parameters[0] = 5;
   ostringstream error_stream;
   Optional<Object> maybe_object =
     posExprClass().maybeMakeObject(parameters,error_stream);
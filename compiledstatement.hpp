@@ -0,0 +1,106 @@
+#ifndef COMPILEDSTATEMENT_HPP_
+#define COMPILEDSTATEMENT_HPP_
+
+#include <string>
+#include <vector>
+#include "environment.hpp"
+#include "symbol.hpp"
+#include "anyoperations.hpp"
+
+
+// This is the bytecode for an expression.  It is a linear sequence of
+// instructions for a small stack machine, which is generated by parsing
+// the expression once.  Literal numbers, strings and names are stored
+// separately and referred to by index.  Names are interned when the
+// expression is compiled.  Each variable reference has its own lookup
+// cache, so the slot that the variable was found in only needs to be
+// resolved by name the first time.  Operations on literal values are
+// done when the expression is compiled, as long as they succeed.
+struct CompiledExpression {
+  enum class Opcode : unsigned char {
+    push_number,
+    push_constant,
+      // The operand is an index into constants.  These are values
+      // which were computed when compiling.
+    push_input,
+    load_variable,
+      // The operand is an index into variables.
+    make_vector,
+    add,
+    subtract,
+    multiply,
+    divide,
+    member,
+      // The operand is an index into symbols.
+    call,
+      // The operand is an index into calls.
+    member_method,
+      // This is a member instruction whose result is called.  If the
+      // object has a method with that name, the object is left on the
+      // stack for the method_call, otherwise it acts like member.
+      // The operand is an index into symbols.
+    method_call,
+      // This is a call whose function came from a member_method.
+      // The operand is an index into calls.
+    fail,
+      // Parsing failed at this point.  The operand is the error message.
+      // We don't report it until we get here so that errors
+      // are reported in the same order as if we were evaluating
+      // while parsing.
+    return_value
+  };
+
+  struct Instruction {
+    Opcode opcode;
+    int operand = 0;
+  };
+
+  struct Variable {
+    Symbol name;
+    VariableLookupCache lookup_cache;
+  };
+
+  std::vector<Instruction> instructions;
+  std::vector<float> numbers;
+  std::vector<Any> constants;
+  std::vector<std::string> strings;
+  std::vector<Symbol> symbols;
+  std::vector<Variable> variables;
+  std::vector<ArgumentNames> calls;
+  int n_folded_operations = 0;
+    // How many operations were done when compiling.  This is for
+    // diagnostics.
+};
+
+
+struct CompiledStatement {
+  enum class Type {
+    expression,
+    show,
+    return_value,
+    assignment,
+    error
+  };
+
+  Type type = Type::error;
+  std::string text;
+    // The original statement text.  This is only kept for diagnostics.
+
+  Symbol variable_name;
+  CompiledExpression expression;
+  std::string error_message;
+
+  bool has_trailing_text = false;
+    // For show statements, which have to be the only thing on the line.
+
+  bool hasEffects() const
+  {
+    // Assignments change the environment for the statements that are
+    // evaluated after them.
+    return
+      type==Type::show || type==Type::return_value || type==Type::assignment;
+  }
+};
+
+
+#endif /* COMPILEDSTATEMENT_HPP_ */
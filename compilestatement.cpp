@@ -0,0 +1,439 @@
+#include "compilestatement.hpp"
+
+#include <sstream>
+#include "stringparser.hpp"
+#include "expressionparser.hpp"
+#include "rangetext.hpp"
+#include "maybeint.hpp"
+
+using std::string;
+using std::vector;
+using std::ostringstream;
+using std::ostream;
+using Opcode = CompiledExpression::Opcode;
+using Instruction = CompiledExpression::Instruction;
+
+
+namespace {
+struct ExpressionCompiler : EvaluatorInterface {
+  const string &text;
+  CompiledExpression &expression;
+  int n_inputs = 0;
+  ArgumentNames argument_names;
+
+  std::vector<int> value_instruction_indices;
+    // For each value that will be on the stack, the index of the
+    // instruction that produces it.  This lets a call find the
+    // instruction that produced the function being called.
+
+  ExpressionCompiler(const string &text_arg,CompiledExpression &expression_arg)
+  : text(text_arg),
+    expression(expression_arg)
+  {
+  }
+
+  void emit(Opcode opcode,int operand = 0)
+  {
+    expression.instructions.push_back({opcode,operand});
+  }
+
+  void emitValue(Opcode opcode,int operand,int n_popped)
+  {
+    assert(int(value_instruction_indices.size())>=n_popped);
+
+    value_instruction_indices.resize(
+      value_instruction_indices.size() - n_popped
+    );
+
+    value_instruction_indices.push_back(expression.instructions.size());
+    emit(opcode,operand);
+  }
+
+  int addString(string arg)
+  {
+    int index = expression.strings.size();
+    expression.strings.push_back(std::move(arg));
+    return index;
+  }
+
+  int addSymbol(const Symbol &arg)
+  {
+    int index = expression.symbols.size();
+    expression.symbols.push_back(arg);
+    return index;
+  }
+
+  int addVariable(const Symbol &name)
+  {
+    int index = expression.variables.size();
+    expression.variables.emplace_back();
+    expression.variables.back().name = name;
+    return index;
+  }
+
+  int addNumber(float arg)
+  {
+    int index = expression.numbers.size();
+    expression.numbers.push_back(arg);
+    return index;
+  }
+
+  int addConstant(Any arg)
+  {
+    int index = expression.constants.size();
+    expression.constants.push_back(std::move(arg));
+    return index;
+  }
+
+  static bool isConstant(const Instruction &instruction)
+  {
+    return
+      instruction.opcode==Opcode::push_number ||
+      instruction.opcode==Opcode::push_constant;
+  }
+
+  Any constantValue(const Instruction &instruction) const
+  {
+    if (instruction.opcode==Opcode::push_number) {
+      return Any(expression.numbers[instruction.operand]);
+    }
+
+    assert(instruction.opcode==Opcode::push_constant);
+    return Any(expression.constants[instruction.operand]);
+  }
+
+  // Determine if the last n values on the stack would come from the
+  // last n instructions, and those instructions push constants.
+  bool lastValuesAreConstant(int n) const
+  {
+    int n_instructions = expression.instructions.size();
+    int n_values = value_instruction_indices.size();
+
+    if (n_instructions<n || n_values<n) {
+      return false;
+    }
+
+    for (int i=0; i!=n; ++i) {
+      int instruction_index = n_instructions - n + i;
+
+      if (value_instruction_indices[n_values - n + i]!=instruction_index) {
+        return false;
+      }
+
+      if (!isConstant(expression.instructions[instruction_index])) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  vector<Any> lastConstants(int n) const
+  {
+    vector<Any> values;
+    auto first = expression.instructions.end() - n;
+
+    for (auto iter = first; iter!=expression.instructions.end(); ++iter) {
+      values.push_back(constantValue(*iter));
+    }
+
+    return values;
+  }
+
+  // Replace the instructions that push the last n constants with one
+  // that pushes the result of the operation on them.
+  void replaceConstants(int n,Any result)
+  {
+    expression.instructions.resize(expression.instructions.size() - n);
+    value_instruction_indices.resize(value_instruction_indices.size() - n);
+    ++expression.n_folded_operations;
+
+    if (result.isFloat()) {
+      emitValue(Opcode::push_number,addNumber(result.asFloat()),0);
+    }
+    else {
+      emitValue(Opcode::push_constant,addConstant(std::move(result)),0);
+    }
+  }
+
+  using BinaryOperation =
+    Optional<Any> (const Any &,const Any &,ostream &error_stream);
+
+  void emitBinary(Opcode opcode,BinaryOperation &operation)
+  {
+    if (lastValuesAreConstant(2)) {
+      vector<Any> operands = lastConstants(2);
+      ostringstream error_stream;
+
+      Optional<Any> maybe_result =
+        operation(operands[0],operands[1],error_stream);
+
+      if (maybe_result) {
+        replaceConstants(2,std::move(*maybe_result));
+        return;
+      }
+
+      // If the operation fails, we leave it to fail when it is
+      // evaluated, so the error is reported the same way.
+    }
+
+    emitValue(opcode,0,/*n_popped*/2);
+  }
+
+  string rangeText(const StringRange &range)
+  {
+    return ::rangeText(range,text);
+  }
+
+  Symbol rangeSymbol(const StringRange &range)
+  {
+    return Symbol(rangeText(range));
+  }
+
+  bool evaluateVariable(const StringRange &identifier_range) override
+  {
+    emitValue(
+      Opcode::load_variable,
+      addVariable(rangeSymbol(identifier_range)),
+      /*n_popped*/0
+    );
+    return true;
+  }
+
+  bool evaluateNumber(const StringRange &number_range) override
+  {
+    Optional<int> maybe_number = maybeInt(rangeText(number_range));
+
+    if (!maybe_number) {
+      // Evaluating the number fails without a message.
+      emitValue(Opcode::fail,addString(""),/*n_popped*/0);
+      return true;
+    }
+
+    emitValue(
+      Opcode::push_number,addNumber(*maybe_number),/*n_popped*/0
+    );
+    return true;
+  }
+
+  bool evaluateDollar() override
+  {
+    emitValue(Opcode::push_input,n_inputs,/*n_popped*/0);
+    ++n_inputs;
+    return true;
+  }
+
+  bool evaluateVector(int n_elements) override
+  {
+    if (lastValuesAreConstant(n_elements)) {
+      vector<Any> elements = lastConstants(n_elements);
+      Any value = makeVectorValue(elements.begin(),elements.end());
+      replaceConstants(n_elements,std::move(value));
+      return true;
+    }
+
+    emitValue(Opcode::make_vector,n_elements,/*n_popped*/n_elements);
+    return true;
+  }
+
+  bool evaluateAddition() override
+  {
+    emitBinary(Opcode::add,maybeAdd);
+    return true;
+  }
+
+  bool evaluateSubtraction() override
+  {
+    emitBinary(Opcode::subtract,maybeSubtract);
+    return true;
+  }
+
+  bool evaluateMultiplication() override
+  {
+    emitBinary(Opcode::multiply,maybeMultiply);
+    return true;
+  }
+
+  bool evaluateDivision() override
+  {
+    emitBinary(Opcode::divide,maybeDivide);
+    return true;
+  }
+
+  bool evaluateMember(const StringRange &name_range) override
+  {
+    emitValue(
+      Opcode::member,addSymbol(rangeSymbol(name_range)),/*n_popped*/1
+    );
+    return true;
+  }
+
+  void evaluateNoName() override
+  {
+    argument_names.emplace_back();
+  }
+
+  void evaluateName(const StringRange &range) override
+  {
+    argument_names.push_back(rangeSymbol(range));
+  }
+
+  bool evaluateCall(const int n_arguments) override
+  {
+    auto first_name = argument_names.end() - n_arguments;
+    int index = expression.calls.size();
+    expression.calls.emplace_back(first_name,argument_names.end());
+    argument_names.erase(first_name,argument_names.end());
+
+    int function_index =
+      value_instruction_indices[
+        value_instruction_indices.size() - n_arguments - 1
+      ];
+
+    CompiledExpression::Instruction &function_instruction =
+      expression.instructions[function_index];
+
+    if (function_instruction.opcode==Opcode::member) {
+      // Calls like obj.f(...) can call a method of obj directly.
+      function_instruction.opcode = Opcode::member_method;
+      emitValue(Opcode::method_call,index,/*n_popped*/n_arguments + 1);
+    }
+    else {
+      emitValue(Opcode::call,index,/*n_popped*/n_arguments + 1);
+    }
+
+    return true;
+  }
+
+  void fail(const string &message)
+  {
+    emit(Opcode::fail,addString(message));
+  }
+};
+}
+
+
+static bool
+  compileExpression(
+    StringParser &parser,
+    const Optional<StringRange> &maybe_identifier_range,
+    CompiledExpression &expression
+  )
+{
+  ExpressionCompiler compiler(parser.text,expression);
+  ostringstream error_stream;
+  ExpressionParser expression_parser(parser,compiler,error_stream);
+
+  bool could_parse =
+    maybe_identifier_range ?
+      expression_parser.parseStartingWithIdentifier(*maybe_identifier_range) :
+      expression_parser.parseExpression();
+
+  if (!could_parse) {
+    compiler.fail(error_stream.str());
+    return false;
+  }
+
+  return true;
+}
+
+
+static bool compileExpression(StringParser &parser,CompiledExpression &expression)
+{
+  return compileExpression(parser,/*maybe_identifier_range*/{},expression);
+}
+
+
+static void endExpression(CompiledExpression &expression)
+{
+  expression.instructions.push_back({Opcode::return_value});
+}
+
+
+CompiledExpression compileExpression(const string &text)
+{
+  CompiledExpression expression;
+  int character_index = 0;
+  StringParser parser{text,character_index};
+
+  if (compileExpression(parser,expression)) {
+    endExpression(expression);
+  }
+
+  return expression;
+}
+
+
+CompiledStatement compileStatement(const string &statement)
+{
+  using Type = CompiledStatement::Type;
+  CompiledStatement result;
+  result.text = statement;
+  CompiledExpression &expression = result.expression;
+
+  int character_index = 0;
+  StringParser parser{statement,character_index};
+  parser.skipWhitespace();
+
+  Optional<StringParser::Range> maybe_identifier_range =
+    parser.maybeIdentifierRange();
+
+  if (!maybe_identifier_range) {
+    result.type = Type::expression;
+
+    if (compileExpression(parser,expression)) {
+      endExpression(expression);
+    }
+
+    return result;
+  }
+
+  string identifier = rangeText(*maybe_identifier_range, parser.text);
+
+  if (identifier=="show") {
+    if (parser.peekChar()!='(') {
+      result.type = Type::error;
+      result.error_message = "Missing '(' after show\n";
+      return result;
+    }
+
+    parser.skipChar();
+    result.type = Type::show;
+
+    if (!compileExpression(parser,expression)) {
+      return result;
+    }
+
+    if (parser.peekChar()!=')') {
+      ExpressionCompiler(statement,expression).fail("Missing ')' for show\n");
+      return result;
+    }
+
+    parser.skipChar();
+    result.has_trailing_text = !parser.atEnd();
+    endExpression(expression);
+    return result;
+  }
+
+  if (identifier=="return") {
+    result.type = Type::return_value;
+  }
+  else if (parser.peekChar() == '=') {
+    parser.skipChar();
+    result.type = Type::assignment;
+    result.variable_name = Symbol(identifier);
+  }
+  else {
+    result.type = Type::expression;
+  }
+
+  if (result.type!=Type::expression) {
+    maybe_identifier_range.reset();
+  }
+
+  if (compileExpression(parser,maybe_identifier_range,expression)) {
+    endExpression(expression);
+  }
+
+  return result;
+}
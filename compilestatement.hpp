@@ -0,0 +1,11 @@
+#ifndef COMPILESTATEMENT_HPP_
+#define COMPILESTATEMENT_HPP_
+
+#include "compiledstatement.hpp"
+
+
+extern CompiledStatement compileStatement(const std::string &statement);
+extern CompiledExpression compileExpression(const std::string &expression);
+
+
+#endif /* COMPILESTATEMENT_HPP_ */
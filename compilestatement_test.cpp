@@ -0,0 +1,148 @@
+#include "compilestatement.hpp"
+
+#include <cassert>
+
+using std::string;
+using Type = CompiledStatement::Type;
+using Opcode = CompiledExpression::Opcode;
+
+
+static void testExpression()
+{
+  CompiledStatement statement = compileStatement("$+x ");
+  assert(statement.type==Type::expression);
+  const CompiledExpression &expression = statement.expression;
+  const auto &instructions = expression.instructions;
+  assert(instructions.size()==4);
+  assert(instructions[0].opcode==Opcode::push_input);
+  assert(instructions[0].operand==0);
+  assert(instructions[1].opcode==Opcode::load_variable);
+  assert(expression.variables[instructions[1].operand].name==Symbol("x"));
+  assert(instructions[2].opcode==Opcode::add);
+  assert(instructions[3].opcode==Opcode::return_value);
+}
+
+
+static void testInputs()
+{
+  CompiledExpression expression = compileExpression("[$,$]");
+  const auto &instructions = expression.instructions;
+  assert(instructions.size()==4);
+  assert(instructions[0].operand==0);
+  assert(instructions[1].operand==1);
+  assert(instructions[2].opcode==Opcode::make_vector);
+  assert(instructions[2].operand==2);
+}
+
+
+static void testAssignment()
+{
+  CompiledStatement statement = compileStatement("x=5 ");
+  assert(statement.type==Type::assignment);
+  assert(statement.variable_name==Symbol("x"));
+  const CompiledExpression &expression = statement.expression;
+  assert(expression.instructions.size()==2);
+  assert(expression.instructions[0].opcode==Opcode::push_number);
+  assert(expression.numbers[expression.instructions[0].operand]==5);
+}
+
+
+static void testParseErrorIsDeferred()
+{
+  CompiledStatement statement = compileStatement("x+(5");
+  const CompiledExpression &expression = statement.expression;
+  const auto &instructions = expression.instructions;
+  assert(instructions.size()==3);
+  assert(instructions[0].opcode==Opcode::load_variable);
+  assert(instructions[2].opcode==Opcode::fail);
+  assert(expression.strings[instructions[2].operand]=="Missing ')'\n");
+}
+
+
+static void testCall()
+{
+  CompiledExpression expression = compileExpression("f(a=1,$).b");
+  const auto &instructions = expression.instructions;
+  assert(instructions.size()==6);
+  assert(instructions[0].opcode==Opcode::load_variable);
+  assert(instructions[3].opcode==Opcode::call);
+  const ArgumentNames &argument_names =
+    expression.calls[instructions[3].operand];
+  assert(argument_names.size()==2);
+  assert(argument_names[0]==Symbol("a"));
+  assert(argument_names[1].empty());
+  assert(instructions[4].opcode==Opcode::member);
+  assert(expression.symbols[instructions[4].operand]==Symbol("b"));
+}
+
+
+static void testMethodCall()
+{
+  CompiledExpression expression = compileExpression("a.f($).g");
+  const auto &instructions = expression.instructions;
+  assert(instructions.size()==6);
+  assert(instructions[1].opcode==Opcode::member_method);
+  assert(expression.symbols[instructions[1].operand]==Symbol("f"));
+  assert(instructions[2].opcode==Opcode::push_input);
+  assert(instructions[3].opcode==Opcode::method_call);
+  assert(expression.calls[instructions[3].operand].size()==1);
+  assert(instructions[4].opcode==Opcode::member);
+}
+
+
+static void testConstantFolding()
+{
+  {
+    CompiledExpression expression = compileExpression("[1,2]*2+[1,1]");
+    const auto &instructions = expression.instructions;
+    assert(instructions.size()==2);
+    assert(instructions[0].opcode==Opcode::push_constant);
+    assert(expression.constants[instructions[0].operand]==makeVector(3,5));
+    assert(expression.n_folded_operations==4);
+  }
+  {
+    CompiledExpression expression = compileExpression("x+2*3");
+    const auto &instructions = expression.instructions;
+    assert(instructions.size()==4);
+    assert(instructions[1].opcode==Opcode::push_number);
+    assert(expression.numbers[instructions[1].operand]==6);
+    assert(instructions[2].opcode==Opcode::add);
+  }
+  {
+    // Operations that fail are left to fail when they are evaluated.
+    CompiledExpression expression = compileExpression("[1,2]+[1,2,3]");
+    const auto &instructions = expression.instructions;
+    assert(instructions.size()==4);
+    assert(instructions[2].opcode==Opcode::add);
+    assert(expression.n_folded_operations==2);
+  }
+}
+
+
+static void testShow()
+{
+  assert(compileStatement("show(5)").type==Type::show);
+  assert(!compileStatement("show(5)").has_trailing_text);
+  assert(compileStatement("show(5)x").has_trailing_text);
+  assert(compileStatement("show").type==Type::error);
+}
+
+
+static void testReturn()
+{
+  assert(compileStatement("return $").type==Type::return_value);
+}
+
+
+int main()
+{
+  testExpression();
+  testInputs();
+  testAssignment();
+  testParseErrorIsDeferred();
+  testCall();
+  testMethodCall();
+  testConstantFolding();
+  testShow();
+  testReturn();
+}
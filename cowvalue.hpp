@@ -0,0 +1,57 @@
+#ifndef COWVALUE_HPP_
+#define COWVALUE_HPP_
+
+#include <cassert>
+#include <memory>
+
+
+// This holds a value which is shared between copies until one of them
+// needs to modify it, so copying is only a reference count increment.
+// Moving leaves the source empty, and it may then only be destroyed or
+// assigned to.
+template <typename T>
+class CowValue {
+  public:
+    explicit CowValue(T value)
+    : value_ptr(std::make_shared<T>(std::move(value)))
+    {
+    }
+
+    const T &get() const
+    {
+      assert(value_ptr);
+      return *value_ptr;
+    }
+
+    T &mutableValue()
+    {
+      assert(value_ptr);
+
+      if (value_ptr.use_count()!=1) {
+        value_ptr = std::make_shared<T>(*value_ptr);
+      }
+
+      return *value_ptr;
+    }
+
+    bool isSharedWith(const CowValue &arg) const
+    {
+      return value_ptr==arg.value_ptr;
+    }
+
+    bool operator==(const CowValue &arg) const
+    {
+      return isSharedWith(arg) || get()==arg.get();
+    }
+
+    bool operator!=(const CowValue &arg) const
+    {
+      return !operator==(arg);
+    }
+
+  private:
+    std::shared_ptr<T> value_ptr;
+};
+
+
+#endif /* COWVALUE_HPP_ */
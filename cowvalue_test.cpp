@@ -0,0 +1,47 @@
+#include "cowvalue.hpp"
+
+#include <string>
+
+using std::string;
+
+
+static void testSharing()
+{
+  CowValue<string> a(string("test"));
+  CowValue<string> b = a;
+  assert(a.isSharedWith(b));
+  assert(&a.get()==&b.get());
+
+  b.mutableValue() += "2";
+  assert(!a.isSharedWith(b));
+  assert(a.get()=="test");
+  assert(b.get()=="test2");
+}
+
+
+static void testEquality()
+{
+  CowValue<string> a(string("test"));
+  CowValue<string> b(string("test"));
+  assert(!a.isSharedWith(b));
+  assert(a==b);
+  b.mutableValue() = "other";
+  assert(a!=b);
+}
+
+
+static void testUnsharedMutation()
+{
+  CowValue<string> a(string("test"));
+  const string *string_ptr = &a.get();
+  a.mutableValue() = "test2";
+  assert(&a.get()==string_ptr);
+}
+
+
+int main()
+{
+  testSharing();
+  testEquality();
+  testUnsharedMutation();
+}
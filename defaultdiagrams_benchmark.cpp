@@ -0,0 +1,180 @@
+#include "defaultdiagrams.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <functional>
+#include "scene.hpp"
+#include "sceneobjects.hpp"
+#include "charmapperobjects.hpp"
+#include "point2dobject.hpp"
+#include "evaluateexpression.hpp"
+#include "expressionvm.hpp"
+#include "evaluatediagram.hpp"
+#include "diagramexecutor.hpp"
+
+using std::vector;
+using std::cout;
+using std::string;
+using Clock = std::chrono::steady_clock;
+
+
+// This compares evaluating the statements of the default pos expr
+// diagrams with the reference evaluator, which parses each statement as
+// it evaluates it, and with the VM, which runs the bytecode that the
+// statements were compiled to.
+
+
+static double nanosecondsPerCall(const std::function<void()> &f)
+{
+  int n_repetitions = 1<<16;
+  Clock::time_point start_time = Clock::now();
+
+  for (int i=0; i!=n_repetitions; ++i) {
+    f();
+  }
+
+  std::chrono::duration<double,std::nano> duration = Clock::now() - start_time;
+  return duration.count()/n_repetitions;
+}
+
+
+namespace {
+struct Statement {
+  string expression_text;
+    // The text that the reference evaluator parses.
+  const CompiledStatement &compiled;
+  const vector<Any> &input_values;
+  int first_input_index;
+    // The statements of a node share the node's inputs, so this is where
+    // the inputs of this statement start.
+};
+}
+
+
+static string expressionText(const CompiledStatement &statement)
+{
+  using Type = CompiledStatement::Type;
+  const string &text = statement.text;
+
+  if (statement.type==Type::return_value) {
+    string::size_type start = text.find("return") + string("return").size();
+    return text.substr(start);
+  }
+
+  assert(statement.type==Type::expression);
+  return text;
+}
+
+
+static void
+  benchmarkDiagram(
+    const string &name,
+    const Diagram &diagram,
+    const Environment &environment
+  )
+{
+  std::ostringstream stream;
+
+  // Evaluate the diagram once to find the input values of each node.
+  DiagramExecutionContext context{stream,stream,&environment};
+  DiagramExecutor executor(context,&environment);
+  DiagramEvaluationState diagram_state;
+  evaluateDiagram(diagram,executor,diagram_state);
+  assert(executor.maybe_return_value);
+
+  vector<vector<Any>> node_input_values(diagram.nNodes());
+  vector<Statement> statements;
+
+  for (NodeIndex node_index : diagram.existingNodeIndices()) {
+    const DiagramNode &node = diagram.node(node_index);
+    vector<Any> &input_values = node_input_values[node_index];
+
+    for (const DiagramNode::Input &input : node.inputs) {
+      input_values.push_back(
+        diagram_state
+        .node_states[input.source_node_index]
+        .output_values[input.source_output_index]
+      );
+    }
+
+    int input_index = 0;
+
+    for (const DiagramNode::Statement &statement : node.statements) {
+      string expression_text = expressionText(statement.compiled);
+
+      statements.push_back(
+        {expression_text,statement.compiled,input_values,input_index}
+      );
+
+      // Let the reference evaluator find how many inputs it uses.
+      int character_index = 0;
+      StringParser parser(expression_text,character_index);
+
+      bool succeeded =
+        !!evaluateExpression(
+          {parser,input_values,input_index,stream,&environment}
+        );
+
+      assert(succeeded);
+    }
+  }
+
+  vector<Any> stack;
+  vector<const Object::Method *> method_stack;
+  volatile bool sink = false;
+
+  auto evaluate_with_reference = [&]{
+    for (const Statement &statement : statements) {
+      int character_index = 0;
+      StringParser parser(statement.expression_text,character_index);
+      int input_index = statement.first_input_index;
+
+      sink =
+        !!evaluateExpression(
+          {parser,statement.input_values,input_index,stream,&environment}
+        );
+    }
+  };
+
+  auto evaluate_with_vm = [&]{
+    for (const Statement &statement : statements) {
+      sink =
+        !!evaluateCompiledExpression(
+          statement.compiled.expression,
+          {statement.input_values,stream,&environment,stack,method_stack}
+        );
+    }
+  };
+
+  double reference_ns = nanosecondsPerCall(evaluate_with_reference);
+  double vm_ns = nanosecondsPerCall(evaluate_with_vm);
+  assert(stream.str().empty());
+
+  cout << name << " (" << statements.size() << " statements, "
+    "ns per evaluation of all of them)\n";
+  cout << "  reference evaluator: " << reference_ns << " ns\n";
+  cout << "  vm: " << vm_ns << " ns\n";
+  cout << "  ratio: " << reference_ns/vm_ns << "\n";
+}
+
+
+int main()
+{
+  Scene scene;
+  Scene::Body &body = scene.addBody("body");
+  Class pos_expr_class = posExprClass();
+  Environment environment;
+  environment["PosExpr"] = &pos_expr_class;
+  environment["target_body"] = makeBodyObject(BodyLink(&scene,&body));
+  environment["source_body"] = makeBodyObject(BodyLink(&scene,&body));
+  environment["local_position"] = makePoint2DObject(Point2D(1,2));
+  environment["global_position"] = makePoint2DObject(Point2D(3,4));
+  environment["x"] = 5.0f;
+  environment["y"] = 6.0f;
+
+  benchmarkDiagram("posExprDiagram",posExprDiagram(),environment);
+  benchmarkDiagram("fromComponentsDiagram",fromComponentsDiagram(),environment);
+  benchmarkDiagram("fromBodyDiagram",fromBodyDiagram(),environment);
+  benchmarkDiagram("localPositionDiagram",localPositionDiagram(),environment);
+}
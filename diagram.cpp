@@ -2,6 +2,8 @@
 
 #include <cassert>
 #include <iostream>
+#include <atomic>
+#include "optimizediagram.hpp"
 
 
 using std::cerr;
@@ -28,30 +30,64 @@ static void copyNodes(const NodeVector &from,NodeVector &to)
 }
 
 
+Diagram::Data::Data() = default;
+
+
+Diagram::Data::Data(const Data &arg)
+{
+  copyNodes(arg.node_ptrs,node_ptrs);
+}
+
+
+Diagram::Data::~Data() = default;
+
+
+Diagram::Diagram()
+: shared_data(Data())
+{
+}
+
+
 Diagram::Diagram(const Diagram &arg)
+: shared_data(arg.shared_data)
 {
-  copyNodes(arg._node_ptrs,_node_ptrs);
 }
 
 
 Diagram& Diagram::operator=(Diagram arg)
 {
-  swap(_node_ptrs,arg._node_ptrs);
-
+  shared_data = arg.shared_data;
   return *this;
 }
 
 
+auto Diagram::mutableData() -> Data &
+{
+  Data &result = shared_data.mutableValue();
+  result.schedule_ptr.reset();
+  result.optimization_ptr.reset();
+  return result;
+}
+
+
+bool Diagram::sharesNodesWith(const Diagram &arg) const
+{
+  return shared_data.isSharedWith(arg.shared_data);
+}
+
+
 Node *Diagram::findNode(NodeIndex i)
 {
-  return _node_ptrs[i].get();
+  return mutableData().node_ptrs[i].get();
 }
 
 
 void Diagram::deleteNode(NodeIndex index)
 {
+  vector<unique_ptr<Node>> &node_ptrs = mutableData().node_ptrs;
+
   // Disconnect source inputs
-  for (const unique_ptr<Node> &node_ptr : _node_ptrs) {
+  for (const unique_ptr<Node> &node_ptr : node_ptrs) {
     if (node_ptr) {
       for (auto &input : node_ptr->inputs) {
         if (input.source_node_index==index) {
@@ -61,16 +97,17 @@ void Diagram::deleteNode(NodeIndex index)
     }
   }
 
-  assert(_node_ptrs[index]);
-  _node_ptrs[index].reset();
+  assert(node_ptrs[index]);
+  node_ptrs[index].reset();
 }
 
 
 NodeIndex Diagram::createNode()
 {
-  NodeIndex node_index = _node_ptrs.size();
+  vector<unique_ptr<Node>> &node_ptrs = mutableData().node_ptrs;
+  NodeIndex node_index = node_ptrs.size();
 
-  _node_ptrs.emplace_back(make_unique<Node>());
+  node_ptrs.emplace_back(make_unique<Node>());
 
   assert(node(node_index).header_text_object.text == "");
 
@@ -91,31 +128,34 @@ NodeIndex Diagram::createNodeWithText(const string &text)
 DiagramNode &Diagram::createNode(NodeIndex node_index)
 {
   assert(node_index>=0);
-  int n_nodes = _node_ptrs.size();
+  vector<unique_ptr<Node>> &node_ptrs = mutableData().node_ptrs;
+  int n_nodes = node_ptrs.size();
 
   if (node_index>=n_nodes) {
-    _node_ptrs.resize(node_index+1);
+    node_ptrs.resize(node_index+1);
   }
 
-  assert(!_node_ptrs[node_index]);
+  assert(!node_ptrs[node_index]);
 
-  _node_ptrs[node_index] = make_unique<Node>();
+  node_ptrs[node_index] = make_unique<Node>();
 
-  return *_node_ptrs[node_index];
+  return *node_ptrs[node_index];
 }
 
 
 Node &Diagram::node(NodeIndex node_index)
 {
-  assert(_node_ptrs[node_index]);
-  return *_node_ptrs[node_index];
+  vector<unique_ptr<Node>> &node_ptrs = mutableData().node_ptrs;
+  assert(node_ptrs[node_index]);
+  return *node_ptrs[node_index];
 }
 
 
 const Node &Diagram::node(NodeIndex node_index) const
 {
-  assert(_node_ptrs[node_index]);
-  return *_node_ptrs[node_index];
+  const vector<unique_ptr<Node>> &node_ptrs = data().node_ptrs;
+  assert(node_ptrs[node_index]);
+  return *node_ptrs[node_index];
 }
 
 
@@ -162,12 +202,13 @@ void Diagram::removeInvalidInputs()
 
 vector<NodeIndex> Diagram::existingNodeIndices() const
 {
+  const vector<unique_ptr<Node>> &node_ptrs = data().node_ptrs;
   vector<NodeIndex> result;
   NodeIndex index = 0;
-  NodeIndex end = _node_ptrs.size();
+  NodeIndex end = node_ptrs.size();
 
   for (;index!=end; ++index) {
-    if (_node_ptrs[index]) {
+    if (node_ptrs[index]) {
       result.push_back(index);
     }
   }
@@ -180,7 +221,7 @@ int Diagram::nExistingNodes() const
 {
   int count = 0;
 
-  for (const unique_ptr<Node> &node_ptr : _node_ptrs) {
+  for (const unique_ptr<Node> &node_ptr : data().node_ptrs) {
     if (node_ptr) {
       ++count;
     }
@@ -192,7 +233,7 @@ int Diagram::nExistingNodes() const
 
 int Diagram::nNodes() const
 {
-  return _node_ptrs.size();
+  return data().node_ptrs.size();
 }
 
 
@@ -219,3 +260,190 @@ vector<NodeIndex>
 
   return new_node_indices;
 }
+
+
+bool Diagram::scheduleIsCurrent(const Schedule &schedule) const
+{
+  // A node can be changed through a reference that was gotten before the
+  // schedule was made, like the one a node text editor keeps, so we
+  // also check that the nodes haven't been recompiled since.
+  for (const Schedule::Step &step : schedule.steps) {
+    const Node &step_node = node(step.node_index);
+
+    if (step_node.revision!=step.node_revision ||
+        step_node.nInputs()!=step.n_inputs) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+auto Diagram::schedule() const -> const Schedule &
+{
+  const Data &shared = data();
+  std::lock_guard<std::mutex> lock(shared.schedule_mutex);
+  updateSchedule(shared);
+  return *shared.schedule_ptr;
+}
+
+
+void Diagram::updateSchedule(const Data &shared) const
+{
+  if (!shared.schedule_ptr || !scheduleIsCurrent(*shared.schedule_ptr)) {
+    shared.schedule_ptr = make_unique<Schedule>(makeSchedule());
+    shared.optimization_ptr.reset();
+  }
+}
+
+
+const DiagramOptimization &Diagram::optimization() const
+{
+  const Data &shared = data();
+  std::lock_guard<std::mutex> lock(shared.schedule_mutex);
+
+  // The schedule notices when a node has changed behind our back, so the
+  // optimization is made again whenever the schedule is.
+  updateSchedule(shared);
+
+  if (!shared.optimization_ptr) {
+    shared.optimization_ptr =
+      make_unique<DiagramOptimization>(optimizeDiagram(*this));
+  }
+
+  return *shared.optimization_ptr;
+}
+
+
+auto Diagram::makeSchedule() const -> Schedule
+{
+  // This visits the nodes in the same order as evaluating each node
+  // after recursively evaluating its sources would, but it keeps its own
+  // stack so that long chains of nodes don't use a lot of native stack.
+  enum class Mark : unsigned char { unvisited, visiting, visited };
+
+  struct Frame {
+    NodeIndex node_index;
+    int next_input_index;
+  };
+
+  int n_nodes = nNodes();
+  vector<Mark> marks(n_nodes,Mark::unvisited);
+  vector<Frame> frames;
+  vector<NodeIndex> order;
+
+  const vector<unique_ptr<Node>> &node_ptrs = data().node_ptrs;
+
+  auto exists = [&](NodeIndex index){
+    return index>=0 && index<n_nodes && node_ptrs[index];
+  };
+
+  for (NodeIndex start_index : existingNodeIndices()) {
+    if (marks[start_index]!=Mark::unvisited) {
+      continue;
+    }
+
+    marks[start_index] = Mark::visiting;
+    frames.push_back({start_index,0});
+
+    while (!frames.empty()) {
+      Frame &frame = frames.back();
+      const Node &frame_node = node(frame.node_index);
+
+      if (frame.next_input_index!=frame_node.nInputs()) {
+        NodeIndex source_index =
+          frame_node.inputs[frame.next_input_index].source_node_index;
+
+        ++frame.next_input_index;
+
+        if (exists(source_index) && marks[source_index]==Mark::unvisited) {
+          marks[source_index] = Mark::visiting;
+          frames.push_back({source_index,0});
+        }
+
+        continue;
+      }
+
+      marks[frame.node_index] = Mark::visited;
+      order.push_back(frame.node_index);
+      frames.pop_back();
+    }
+  }
+
+  Schedule schedule;
+  vector<int> step_indices(n_nodes,-1);
+
+  for (NodeIndex node_index : order) {
+    const Node &step_node = node(node_index);
+    int step_index = schedule.steps.size();
+    int n_inputs = step_node.nInputs();
+    int first_input_slot = schedule.input_slots.size();
+    int n_statements = step_node.statements.size();
+    int first_statement = schedule.statements.size();
+    bool has_effects = false;
+    bool reads_variables = false;
+    int line_index = 0;
+    int output_index = 0;
+    step_indices[node_index] = step_index;
+
+    for (const Node::Statement &statement : step_node.statements) {
+      const CompiledStatement &compiled = statement.compiled;
+      Schedule::Statement scheduled_statement;
+      scheduled_statement.compiled_ptr = &compiled;
+      scheduled_statement.output_index = -1;
+      scheduled_statement.first_line_index = line_index;
+      scheduled_statement.n_lines = statement.n_lines;
+
+      if (statement.has_output) {
+        scheduled_statement.output_index = output_index;
+        ++output_index;
+      }
+
+      if (compiled.hasEffects()) {
+        has_effects = true;
+      }
+
+      if (!compiled.expression.variables.empty()) {
+        reads_variables = true;
+      }
+
+      schedule.statements.push_back(scheduled_statement);
+      line_index += statement.n_lines;
+    }
+
+    Schedule::Step step;
+    step.node_index = node_index;
+    step.first_input_slot = first_input_slot;
+    step.n_inputs = n_inputs;
+    step.first_statement = first_statement;
+    step.n_statements = n_statements;
+    step.n_outputs = step_node.nOutputs();
+    step.n_lines = step_node.nLines();
+    step.node_revision = step_node.revision;
+    step.has_effects = has_effects;
+    step.reads_variables = reads_variables;
+    schedule.steps.push_back(step);
+
+    for (const Node::Input &input : step_node.inputs) {
+      Schedule::InputSlot slot;
+      NodeIndex source_index = input.source_node_index;
+
+      bool source_is_earlier =
+        exists(source_index) &&
+        step_indices[source_index]>=0 &&
+        step_indices[source_index]<step_index;
+
+      if (source_is_earlier && input.source_output_index>=0) {
+        slot.source_node_index = source_index;
+        slot.source_output_index = input.source_output_index;
+      }
+
+      schedule.input_slots.push_back(slot);
+    }
+  }
+
+  static std::atomic<unsigned long> last_revision(0);
+  schedule.revision = ++last_revision;
+  return schedule;
+}
@@ -3,14 +3,20 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 #include "diagramnode.hpp"
+#include "cowvalue.hpp"
 
+struct DiagramOptimization;
 
+// Copies of a diagram share their nodes, including the nodes' compiled
+// statements and the schedule, until one of the copies is modified.
 class Diagram {
   public:
     using Node = DiagramNode;
+    struct Schedule;
 
-    Diagram() = default;
+    Diagram();
     Diagram(const Diagram &);
 
     Diagram& operator=(Diagram);
@@ -54,8 +60,94 @@ class Diagram {
         const std::vector<NodeIndex> &indices_of_nodes_to_duplicate
       );
 
+    bool sharesNodesWith(const Diagram &) const;
+      // This is true if the two diagrams are copies of each other and
+      // neither has been modified since they were copied.
+
+    const Schedule &schedule() const;
+      // This is computed when it is first needed after the diagram
+      // changes.  Getting a non-const node counts as a change, since the
+      // node's inputs could be modified through it, and so does
+      // recompiling a node's statements through a reference that was
+      // gotten earlier.
+
+    const DiagramOptimization &optimization() const;
+      // The result of optimizeDiagram(), which is kept along with the
+      // schedule.
+
+    // The order to evaluate the nodes in, so that each node comes after
+    // the nodes that its inputs come from.  This also has everything
+    // about the nodes that is needed to evaluate them, in a few flat
+    // arrays, so that evaluation doesn't have to go through each node's
+    // own vectors.
+    struct Schedule {
+      struct Step {
+        NodeIndex node_index;
+        int first_input_slot;
+        int n_inputs;
+        int first_statement;
+        int n_statements;
+        int n_outputs;
+        int n_lines;
+        unsigned long node_revision;
+        bool has_effects;
+        bool reads_variables;
+      };
+
+      struct Statement {
+        const CompiledStatement *compiled_ptr;
+        int output_index;
+          // This is -1 if the statement doesn't have an output.
+        int first_line_index;
+        int n_lines;
+      };
+
+      struct InputSlot {
+        NodeIndex source_node_index = nullNodeIndex();
+        int source_output_index = -1;
+      };
+
+      std::vector<Step> steps;
+
+      std::vector<InputSlot> input_slots;
+        // The sources of the inputs for each step, starting at the step's
+        // first_input_slot.  Inputs that aren't connected, or which
+        // come from a node that isn't evaluated before this one because
+        // the connections form a cycle, have no source.
+
+      std::vector<Statement> statements;
+        // The statements of each step, starting at the step's
+        // first_statement.
+
+      unsigned long revision = 0;
+        // Each schedule that is made gets a new revision, so this changes
+        // whenever the diagram does.
+    };
+
   private:
-    std::vector<std::unique_ptr<Node>> _node_ptrs;
+    struct Data {
+      std::vector<std::unique_ptr<Node>> node_ptrs;
+      mutable std::unique_ptr<Schedule> schedule_ptr;
+      mutable std::unique_ptr<DiagramOptimization> optimization_ptr;
+      mutable std::mutex schedule_mutex;
+        // This is held while making the schedule or the optimization.
+
+      Data();
+      Data(const Data &);
+        // This copies the nodes, but not the schedule or the optimization.
+      ~Data();
+    };
+
+    CowValue<Data> shared_data;
+
+    const Data &data() const { return shared_data.get(); }
+    Data &mutableData();
+      // This makes our own copy of the nodes if they are shared, and
+      // invalidates the schedule and the optimization.
+
+    Schedule makeSchedule() const;
+    bool scheduleIsCurrent(const Schedule &) const;
+    void updateSchedule(const Data &) const;
 };
 
 #endif /* DIAGRAM_HPP_ */
@@ -10,6 +10,7 @@ using std::ostringstream;
 using std::ostream;
 using std::string;
 using std::cerr;
+using std::vector;
 
 
 
@@ -183,6 +184,162 @@ static void testAssign()
 }
 
 
+static void testCopiesShareNodesUntilModified()
+{
+  Diagram d1;
+  NodeIndex n1 = d1.createNodeWithText("5");
+  Diagram d2(d1);
+  const Diagram &const_d1 = d1;
+  const Diagram &const_d2 = d2;
+  assert(d2.sharesNodesWith(d1));
+  assert(&const_d2.node(n1)==&const_d1.node(n1));
+  assert(&const_d2.schedule()==&const_d1.schedule());
+
+  d2.setNodeText(n1,"6");
+  assert(!d2.sharesNodesWith(d1));
+  assert(const_d1.node(n1).text()=="5\n");
+  assert(const_d2.node(n1).text()=="6\n");
+
+  Diagram d3;
+  d3 = d1;
+  assert(d3.sharesNodesWith(d1));
+  d3.createNode();
+  assert(!d3.sharesNodesWith(d1));
+  assert(d1.nNodes()==1);
+  assert(d3.nNodes()==2);
+}
+
+
+static vector<NodeIndex> scheduledNodes(const Diagram &diagram)
+{
+  vector<NodeIndex> result;
+
+  for (auto &step : diagram.schedule().steps) {
+    result.push_back(step.node_index);
+  }
+
+  return result;
+}
+
+
+static void testSchedule()
+{
+  Diagram diagram;
+  NodeIndex n0 = diagram.createNodeWithText("show($)");
+  NodeIndex n1 = diagram.createNodeWithText("$+1");
+  NodeIndex n2 = diagram.createNodeWithText("5");
+  diagram.connectNodes(n2,0,n1,0);
+  assert(scheduledNodes(diagram)==vector<NodeIndex>({n0,n2,n1}));
+
+  // Each node comes after its sources.
+  diagram.connectNodes(n1,0,n0,0);
+  assert(scheduledNodes(diagram)==vector<NodeIndex>({n2,n1,n0}));
+  const Diagram::Schedule &schedule = diagram.schedule();
+  const Diagram::Schedule::Step &step = schedule.steps[2];
+  assert(step.n_inputs==1);
+  assert(schedule.input_slots[step.first_input_slot].source_node_index==n1);
+
+  diagram.deleteNode(n1);
+  assert(scheduledNodes(diagram)==vector<NodeIndex>({n0,n2}));
+
+  NodeIndex n3 = diagram.createNodeWithText("return $");
+  diagram.connectNodes(n2,0,n3,0);
+  assert(scheduledNodes(diagram)==vector<NodeIndex>({n0,n2,n3}));
+
+  diagram.setNodeText(n2,"return 1");
+  assert(scheduledNodes(diagram)==vector<NodeIndex>({n0,n2,n3}));
+  assert(diagram.schedule().input_slots[1].source_node_index==nullNodeIndex());
+}
+
+
+static void testScheduleWithCycle()
+{
+  Diagram diagram;
+  NodeIndex n0 = diagram.createNodeWithText("$");
+  NodeIndex n1 = diagram.createNodeWithText("$");
+  diagram.connectNodes(n0,0,n1,0);
+  diagram.connectNodes(n1,0,n0,0);
+  assert(scheduledNodes(diagram)==vector<NodeIndex>({n1,n0}));
+
+  // The first node in the cycle gets no value for its input.
+  const Diagram::Schedule &schedule = diagram.schedule();
+  assert(schedule.input_slots[0].source_node_index==nullNodeIndex());
+  assert(schedule.input_slots[1].source_node_index==n1);
+
+  ostringstream stream;
+  evaluate(diagram,stream);
+}
+
+
+static void testScheduledStatements()
+{
+  Diagram diagram;
+  NodeIndex n0 = diagram.createNodeWithText("a=1\n[\n2\n]\n$+a");
+  NodeIndex n1 = diagram.createNodeWithText("5");
+  diagram.connectNodes(n1,0,n0,0);
+  const Diagram &const_diagram = diagram;
+  const Diagram::Schedule &schedule = const_diagram.schedule();
+  assert(schedule.steps.size()==2);
+
+  const Diagram::Schedule::Step &step0 = schedule.steps[0];
+  assert(step0.node_index==n1);
+  assert(step0.n_statements==1);
+  assert(step0.n_outputs==1);
+  assert(!step0.has_effects);
+  assert(!step0.reads_variables);
+
+  const Diagram::Schedule::Step &step1 = schedule.steps[1];
+  assert(step1.node_index==n0);
+  assert(step1.n_statements==3);
+  assert(step1.n_outputs==1);
+  assert(step1.n_lines==5);
+  assert(step1.node_revision==const_diagram.node(n0).revision);
+  assert(step1.has_effects);
+  assert(step1.reads_variables);
+
+  const Diagram::Schedule::Statement *statements =
+    &schedule.statements[step1.first_statement];
+
+  assert(statements[0].output_index==-1);
+  assert(statements[1].first_line_index==1);
+  assert(statements[1].n_lines==3);
+  assert(statements[2].output_index==0);
+  assert(statements[2].first_line_index==4);
+
+  assert(
+    statements[2].compiled_ptr==&const_diagram.node(n0).statements[2].compiled
+  );
+}
+
+
+static void testChangingANodeThroughAnEarlierReference()
+{
+  Diagram diagram;
+  NodeIndex n = diagram.createNodeWithText("5");
+  Diagram::Node &node = diagram.node(n);
+  const Diagram &const_diagram = diagram;
+  assert(const_diagram.schedule().steps[0].n_statements==1);
+
+  // The reference was gotten before the schedule was made, so the diagram
+  // doesn't know that the node is being changed.
+  node.setText("1\n2\n3");
+
+  const Diagram::Schedule &schedule = const_diagram.schedule();
+  const Diagram::Schedule::Step &step = schedule.steps[0];
+  assert(step.n_statements==3);
+  assert(step.node_revision==node.revision);
+
+  assert(
+    schedule.statements[step.first_statement + 2].compiled_ptr==
+    &node.statements[2].compiled
+  );
+
+  DiagramEvaluationState diagram_state;
+  evaluateDiagram(diagram,diagram_state);
+  assert(diagram_state.node_states[n].output_values[2]==3);
+}
+
+
 int main()
 {
   testEvaluation1();
@@ -197,4 +354,9 @@ int main()
   testEvaluatingIncompleteVectorOverTwoLines();
   testCopy();
   testAssign();
+  testCopiesShareNodesUntilModified();
+  testSchedule();
+  testScheduleWithCycle();
+  testScheduledStatements();
+  testChangingANodeThroughAnEarlierReference();
 }
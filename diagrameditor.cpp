@@ -777,7 +777,7 @@ bool
     const ViewportPoint &p
   ) const
 {
-  Node &node = diagram().node(node_index);
+  const Node &node = constDiagram().node(node_index);
   NodeRenderInfo render_info = nodeRenderInfo(node);
 
   if (render_info.header_rect.contains(p)) {
@@ -818,7 +818,8 @@ bool
     const ViewportPoint &p
   )
 {
-  return nodeInputCircle(node(node_index),input_index).contains(p);
+  const Node &node = constDiagram().node(node_index);
+  return nodeInputCircle(node,input_index).contains(p);
 }
 
 
@@ -837,7 +838,8 @@ bool
     const ViewportPoint &p
   )
 {
-  return nodeOutputCircle(node(node_index),output_index).contains(p);
+  const Node &node = constDiagram().node(node_index);
+  return nodeOutputCircle(node,output_index).contains(p);
 }
 
 
@@ -845,7 +847,7 @@ NodeConnectorIndex
   DiagramEditor::indexOfNodeConnectorContaining(const ViewportPoint &p)
 {
   for (NodeIndex i : diagram().existingNodeIndices()) {
-    int n_inputs = node(i).nInputs();
+    int n_inputs = constDiagram().node(i).nInputs();
     for (int j=0; j!=n_inputs; ++j) {
       if (nodeInputContains(i,j,p)) {
         NodeConnectorIndex index;
@@ -855,7 +857,7 @@ NodeConnectorIndex
         return index;
       }
     }
-    int n_outputs = node(i).nOutputs();
+    int n_outputs = constDiagram().node(i).nOutputs();
     for (int j=0; j!=n_outputs; ++j) {
       if (nodeOutputContains(i,j,p)) {
         NodeConnectorIndex index;
@@ -877,7 +879,7 @@ bool
     const ViewportRect &rect
   ) const
 {
-  Node &node = diagram().node(node_index);
+  const Node &node = constDiagram().node(node_index);
   NodeRenderInfo render_info = nodeRenderInfo(node);
 
   return rect.contains(render_info.body_outer_rect);
@@ -1161,7 +1163,7 @@ void
 
       for (auto node_index : selected_node_indices) {
         original_node_positions[node_index] =
-          node(node_index).header_text_object.position;
+          constDiagram().node(node_index).header_text_object.position;
       }
 
       redraw();
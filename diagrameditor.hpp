@@ -143,6 +143,12 @@ class DiagramEditor {
     void alsoSelectNode(NodeIndex node_index);
     void focusNode(int node_index,Diagram &diagram);
     Diagram &diagram() const { assert(diagramPtr()); return *diagramPtr(); }
+
+    const Diagram &constDiagram() const { return diagram(); }
+      // Use this when only looking at the diagram, since getting a
+      // non-const node from it stops it from sharing its nodes and throws
+      // away its schedule.
+
     void unfocus();
     ViewportCircle nodeInputCircle(const Node &,int input_index);
     Node &node(NodeIndex arg) { return diagram().node(arg); }
@@ -151,7 +157,10 @@ class DiagramEditor {
       viewportTextObject(
         const DiagramTextObject &diagram_text_object
       ) const;
-    const Node &node(NodeIndex arg) const { return diagram().node(arg); }
+    const Node &node(NodeIndex arg) const
+    {
+      return constDiagram().node(arg);
+    }
 
     DiagramVector
       diagramVectorFromViewportVector(const ViewportVector &) const;
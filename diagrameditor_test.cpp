@@ -377,6 +377,25 @@ static void testRectangleSelectingMultipleNodes2()
 }
 
 
+static void testSelectingKeepsTheDiagramShared()
+{
+  Tester tester;
+  FakeDiagramEditor &editor = tester.editor;
+  NodeIndex n1 = editor.userAddsANodeWithTextAt("x",DiagramPoint(10,10));
+  NodeIndex n2 = editor.userAddsANodeWithTextAt("y",DiagramPoint(20,20));
+  editor.userPressesEscape();
+  Diagram copy = tester.diagram;
+
+  editor.userPressesMouseAt(ViewportPoint(0,0));
+  editor.userMovesMouseTo(ViewportPoint(40,40));
+  editor.userReleasesMouseAt(ViewportPoint(40,40));
+
+  assert(editor.nodeIsSelected(n1));
+  assert(editor.nodeIsSelected(n2));
+  assert(copy.sharesNodesWith(tester.diagram));
+}
+
+
 static void testTranslatingView()
 {
   Tester tester;
@@ -766,6 +785,7 @@ int main()
   testShiftSelectingMultipleNodes();
   testRectangleSelectingMultipleNodes1();
   testRectangleSelectingMultipleNodes2();
+  testSelectingKeepsTheDiagramShared();
   testTranslatingView();
   testTranslatingView2();
   testCancellingExport();
@@ -4,22 +4,76 @@
 using std::make_unique;
 
 
+static const int first_environment_block_size = 8;
+
+
 Environment &
   DiagramEvaluationState::allocateEnvironment(
     const Environment *parent_environment_ptr
   )
 {
-  environment_ptrs.emplace_back(
-    make_unique<Environment>(parent_environment_ptr)
-  );
+  int block_index = 0;
+  int block_size = first_environment_block_size;
+  int index = n_allocated_environments;
+
+  while (index>=block_size) {
+    index -= block_size;
+    block_size *= 2;
+    ++block_index;
+  }
+
+  if (block_index==int(environment_blocks.size())) {
+    environment_blocks.push_back(make_unique<Environment[]>(block_size));
+  }
+
+  assert(block_index<int(environment_blocks.size()));
+  Environment &environment = environment_blocks[block_index][index];
+  environment.layout_ptr = &EnvironmentLayout::empty();
+  environment.slot_values.clear();
+  environment.parent_environment_ptr = parent_environment_ptr;
+  ++n_allocated_environments;
+  return environment;
+}
+
+
+void DiagramEvaluationState::releaseEnvironments()
+{
+  n_allocated_environments = 0;
+}
+
+
+static void resetNodeState(DiagramEvaluationState::NodeState &node_state)
+{
+  node_state.output_values.clear();
+  node_state.line_errors.clear();
+  node_state.is_reusable = false;
+  node_state.node_revision = 0;
+  node_state.evaluated_statements.clear();
+  node_state.input_values.clear();
+  node_state.variable_values.clear();
+  node_state.memo_entries.clear();
+  node_state.next_memo_entry_index = 0;
+}
+
+
+void DiagramEvaluationState::reset()
+{
+  for (NodeState &node_state : node_states) {
+    resetNodeState(node_state);
+  }
 
-  assert(environment_ptrs.back());
-  return *environment_ptrs.back();
+  releaseEnvironments();
+  n_node_evaluations = 0;
+  n_memo_hits = 0;
+  n_memo_misses = 0;
 }
 
 
 void DiagramEvaluationState::clear()
 {
   node_states.clear();
-  environment_ptrs.clear();
+  releaseEnvironments();
+  n_node_evaluations = 0;
+  n_memo_hits = 0;
+  n_memo_misses = 0;
 }
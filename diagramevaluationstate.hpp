@@ -2,14 +2,48 @@
 #define DIAGRAMSTATE_HPP_
 
 
+#include <sstream>
 #include "any.hpp"
 #include "environment.hpp"
 
 
 struct DiagramEvaluationState {
+  struct VariableValue {
+    bool was_found = false;
+    Any value;
+  };
+
+  // The results of evaluating a pure node with particular input values.
+  struct MemoEntry {
+    size_t input_hash = 0;
+    unsigned long node_revision = 0;
+    std::vector<bool> evaluated_statements;
+    std::vector<Any> input_values;
+    std::vector<Any> output_values;
+    std::vector<std::string> line_errors;
+  };
+
   struct NodeState {
     std::vector<Any> output_values;
     std::vector<std::string> line_errors;
+
+    // These are what the output values and line errors were computed
+    // from.  If none of them have changed, the node doesn't need to be
+    // evaluated again.
+    bool is_reusable = false;
+    unsigned long node_revision = 0;
+    std::vector<bool> evaluated_statements;
+      // An optimized evaluation may skip some statements.
+    std::vector<Any> input_values;
+    std::vector<VariableValue> variable_values;
+      // There is one of these for each variable that the node's
+      // statements read, in order.
+
+    std::vector<MemoEntry> memo_entries;
+      // Results for other input values, for nodes that only depend on
+      // their inputs.
+    int next_memo_entry_index = 0;
+      // Which entry to replace when there are already the maximum number.
   };
 
   DiagramEvaluationState() = default;
@@ -20,9 +54,33 @@ struct DiagramEvaluationState {
   DiagramEvaluationState &operator=(DiagramEvaluationState &&) = default;
 
   std::vector<NodeState> node_states;
-  std::vector<std::unique_ptr<Environment>> environment_ptrs;
+  std::vector<std::unique_ptr<Environment[]>> environment_blocks;
+    // Environments are allocated from these blocks, which double in size.
+    // The blocks are kept when the environments are released, so once
+    // there are enough of them, allocating an environment doesn't
+    // allocate memory.  An environment's slots keep their capacity too.
+  int n_allocated_environments = 0;
+  std::vector<Any> evaluation_stack;
+  std::vector<const Object::Method *> method_stack;
+  int n_node_evaluations = 0;
+    // How many times a node was evaluated instead of reusing its previous
+    // state.  This is for diagnostics.
+  int max_memo_entries_per_node = 8;
+  int n_memo_hits = 0;
+  int n_memo_misses = 0;
+  std::ostringstream statement_error_stream;
+    // Statement errors are written here.  It is only read and cleared
+    // when something was written, so statements that succeed don't
+    // create any strings.
 
   Environment &allocateEnvironment(const Environment *parent_environment_ptr);
+  void releaseEnvironments();
+    // Makes all the environments available to be allocated again.  They
+    // keep their values until then.
+
+  void reset();
+    // Forgets everything from earlier evaluations, but keeps the memory
+    // that was allocated for it so that it can be used again.
 
   void clear();
 };
@@ -1,12 +1,51 @@
 #include "diagramevaluationstate.hpp"
 
+using std::vector;
+
 
 static void testAllocateEnvironment()
 {
   DiagramEvaluationState diagram_state;
   const Environment *parent_environment_ptr = nullptr;
   diagram_state.allocateEnvironment(parent_environment_ptr);
-  assert(!diagram_state.environment_ptrs.empty());
+  assert(diagram_state.n_allocated_environments==1);
+}
+
+
+static void testReusingEnvironments()
+{
+  DiagramEvaluationState diagram_state;
+  Environment parent_environment;
+  vector<Environment *> environment_ptrs;
+  int n_environments = 100;
+
+  for (int i=0; i!=n_environments; ++i) {
+    Environment &environment =
+      diagram_state.allocateEnvironment(&parent_environment);
+
+    environment["x"] = float(i);
+    environment_ptrs.push_back(&environment);
+  }
+
+  // Allocating more environments doesn't move the earlier ones.
+  for (int i=0; i!=n_environments; ++i) {
+    assert((*environment_ptrs[i])["x"]==float(i));
+  }
+
+  int n_blocks = diagram_state.environment_blocks.size();
+  diagram_state.releaseEnvironments();
+
+  for (int i=0; i!=n_environments; ++i) {
+    Environment &environment =
+      diagram_state.allocateEnvironment(/*parent_environment_ptr*/nullptr);
+
+    assert(&environment==environment_ptrs[i]);
+    assert(environment.layout().nSlots()==0);
+    assert(environment.slot_values.empty());
+    assert(!environment.parent_environment_ptr);
+  }
+
+  assert(int(diagram_state.environment_blocks.size())==n_blocks);
 }
 
 
@@ -15,16 +54,51 @@ static void testClear()
   DiagramEvaluationState diagram_state;
   diagram_state.node_states.resize(1);
   diagram_state.allocateEnvironment(/*parent_environment_ptr*/nullptr);
+  diagram_state.n_node_evaluations = 1;
+  diagram_state.n_memo_hits = 1;
+  diagram_state.n_memo_misses = 1;
 
   diagram_state.clear();
 
   assert(diagram_state.node_states.empty());
-  assert(diagram_state.environment_ptrs.empty());
+  assert(diagram_state.n_allocated_environments==0);
+  assert(diagram_state.n_node_evaluations==0);
+  assert(diagram_state.n_memo_hits==0);
+  assert(diagram_state.n_memo_misses==0);
+}
+
+
+static void testReset()
+{
+  DiagramEvaluationState diagram_state;
+  diagram_state.node_states.resize(2);
+  DiagramEvaluationState::NodeState &node_state = diagram_state.node_states[0];
+  node_state.output_values.resize(3);
+  node_state.line_errors.resize(3);
+  node_state.is_reusable = true;
+  const Any *output_values_data = node_state.output_values.data();
+  diagram_state.allocateEnvironment(/*parent_environment_ptr*/nullptr);
+  diagram_state.n_node_evaluations = 1;
+
+  diagram_state.reset();
+
+  assert(diagram_state.node_states.size()==2);
+  assert(node_state.output_values.empty());
+  assert(node_state.line_errors.empty());
+  assert(!node_state.is_reusable);
+  assert(diagram_state.n_allocated_environments==0);
+  assert(diagram_state.n_node_evaluations==0);
+
+  // The memory is kept.
+  node_state.output_values.resize(3);
+  assert(node_state.output_values.data()==output_values_data);
 }
 
 
 int main()
 {
   testAllocateEnvironment();
+  testReusingEnvironments();
   testClear();
+  testReset();
 }
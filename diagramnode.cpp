@@ -1,9 +1,11 @@
 #include "diagramnode.hpp"
 
 #include <cassert>
+#include <atomic>
 #include "statementtext.hpp"
 #include "linetext.hpp"
 #include "splitlines.hpp"
+#include "compilestatement.hpp"
 
 using std::vector;
 using std::string;
@@ -64,6 +66,7 @@ void Node::updateInputsAndOutputs()
 
   updateNInputs();
   updateNOutputs();
+  compileStatements();
 }
 
 
@@ -111,6 +114,44 @@ void Node::addOutputs()
   assert(!statements.empty());
 
   updateNOutputs();
+  compileStatements();
+}
+
+
+string Node::statementText(int statement_index) const
+{
+  int line_index = 0;
+
+  for (int i=0; i!=statement_index; ++i) {
+    line_index += statements[i].n_lines;
+  }
+
+  int end_line_index = line_index + statements[statement_index].n_lines;
+  string result = "";
+
+  for (; line_index!=end_line_index; ++line_index) {
+    result += lines[line_index].text + " ";
+  }
+
+  return result;
+}
+
+
+static unsigned long newRevision()
+{
+  static std::atomic<unsigned long> last_revision(0);
+  return ++last_revision;
+}
+
+
+void Node::compileStatements()
+{
+  int n_statements = statements.size();
+  revision = newRevision();
+
+  for (int i=0; i!=n_statements; ++i) {
+    statements[i].compiled = compileStatement(statementText(i));
+  }
 }
 
 
@@ -314,6 +355,7 @@ void Node::deleteCharacter(const TextPosition &position)
   }
 
   text.erase(text.begin() + column_index);
+  compileStatements();
 }
 
 
@@ -5,6 +5,7 @@
 #include <iostream>
 #include "textobject.hpp"
 #include "nodeindex.hpp"
+#include "compiledstatement.hpp"
 
 
 class DiagramNode {
@@ -27,6 +28,11 @@ class DiagramNode {
       //     20
       //   ]
 
+    unsigned long revision = 0;
+      // This changes every time the statements are compiled, so results
+      // that were computed from the statements can be reused until the
+      // text changes.
+
     DiagramTextObject header_text_object;
 
     void setText(const std::string &text);
@@ -40,6 +46,7 @@ class DiagramNode {
     std::vector<bool> determineStatementOutputFlags() const;
     void updateInputsAndOutputs();
     std::string joinLines(int start,int n_lines,char separator) const;
+    std::string statementText(int statement_index) const;
     void addInputsAndOutputs();
     bool isEmpty() const;
     std::vector<std::string> lineTexts() const;
@@ -75,6 +82,9 @@ class DiagramNode {
     struct Statement {
       int n_lines = 0;
       bool has_output = false;
+      CompiledStatement compiled;
+        // This is rebuilt whenever the text changes, so that evaluating
+        // the statement doesn't require parsing it again.
     };
 
     struct TextPosition {
@@ -115,6 +125,7 @@ class DiagramNode {
     int inputIndexAt(const TextPosition &position) const;
     void addInputs();
     void addOutputs();
+    void compileStatements();
 
     static size_t countInputs(const DiagramNode &);
       // Should we rename this to countUsedInputs()?
@@ -0,0 +1,45 @@
+#include "diagramstatepool.hpp"
+
+
+DiagramEvaluationState &DiagramStatePool::stateFor(const Diagram &diagram)
+{
+  std::lock_guard<std::mutex> lock(entries_mutex);
+  auto iter = entries.find(&diagram);
+
+  if (iter==entries.end()) {
+    iter = entries.emplace(&diagram,Entry()).first;
+
+    if (!free_states.empty()) {
+      iter->second.diagram_state = std::move(free_states.back());
+      free_states.pop_back();
+    }
+  }
+
+  Entry &entry = iter->second;
+  entry.was_used = true;
+  return entry.diagram_state;
+}
+
+
+void DiagramStatePool::releaseUnusedStates()
+{
+  std::lock_guard<std::mutex> lock(entries_mutex);
+  auto iter = entries.begin();
+
+  while (iter!=entries.end()) {
+    Entry &entry = iter->second;
+
+    if (entry.was_used) {
+      entry.was_used = false;
+      ++iter;
+      continue;
+    }
+
+    if (int(free_states.size())<max_free_states) {
+      entry.diagram_state.reset();
+      free_states.push_back(std::move(entry.diagram_state));
+    }
+
+    iter = entries.erase(iter);
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef DIAGRAMSTATEPOOL_HPP_
+#define DIAGRAMSTATEPOOL_HPP_
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include "diagram.hpp"
+#include "diagramevaluationstate.hpp"
+
+
+// This keeps an evaluation state for each diagram that is evaluated, so
+// that evaluating the diagram again can reuse the results and the memory
+// from the last time.  States of diagrams that stop being evaluated are
+// reset and given to other diagrams.  States for different diagrams can be
+// gotten from several threads at once.
+class DiagramStatePool {
+  public:
+    DiagramStatePool() = default;
+    DiagramStatePool(const DiagramStatePool &) = delete;
+    void operator=(const DiagramStatePool &) = delete;
+
+    DiagramEvaluationState &stateFor(const Diagram &);
+
+    void releaseUnusedStates();
+      // Frees up the states of the diagrams which haven't been used since
+      // the last call.
+
+    int nStates() const { return entries.size(); }
+    int nFreeStates() const { return free_states.size(); }
+
+    int max_free_states = 8;
+
+  private:
+    struct Entry {
+      DiagramEvaluationState diagram_state;
+      bool was_used = false;
+    };
+
+    std::map<const Diagram *,Entry> entries;
+      // A diagram could be destroyed and a different one created at the
+      // same address, but that's okay since node results are only reused
+      // if the node revisions match.
+    std::vector<DiagramEvaluationState> free_states;
+    std::mutex entries_mutex;
+};
+
+
+#endif /* DIAGRAMSTATEPOOL_HPP_ */
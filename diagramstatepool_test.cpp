@@ -0,0 +1,66 @@
+#include "diagramstatepool.hpp"
+
+#include <cassert>
+
+
+static void testGettingTheSameState()
+{
+  DiagramStatePool pool;
+  Diagram diagram1;
+  Diagram diagram2;
+  DiagramEvaluationState &state1 = pool.stateFor(diagram1);
+  DiagramEvaluationState &state2 = pool.stateFor(diagram2);
+  assert(&state1!=&state2);
+  assert(&pool.stateFor(diagram1)==&state1);
+  assert(pool.nStates()==2);
+}
+
+
+static void testReleasingUnusedStates()
+{
+  DiagramStatePool pool;
+  Diagram diagram1;
+  Diagram diagram2;
+  Diagram diagram3;
+  pool.stateFor(diagram1);
+  DiagramEvaluationState &state2 = pool.stateFor(diagram2);
+  state2.node_states.resize(3);
+  state2.node_states[0].output_values.resize(1);
+  pool.releaseUnusedStates();
+  assert(pool.nStates()==2);
+
+  // Only diagram1 is used this time, so the state for diagram2 is freed.
+  pool.stateFor(diagram1);
+  pool.releaseUnusedStates();
+  assert(pool.nStates()==1);
+  assert(pool.nFreeStates()==1);
+
+  // The freed state is reused, but it doesn't have the old results.
+  DiagramEvaluationState &state3 = pool.stateFor(diagram3);
+  assert(pool.nFreeStates()==0);
+  assert(state3.node_states.size()==3);
+  assert(state3.node_states[0].output_values.empty());
+}
+
+
+static void testLimitingFreeStates()
+{
+  DiagramStatePool pool;
+  pool.max_free_states = 1;
+  Diagram diagram1;
+  Diagram diagram2;
+  pool.stateFor(diagram1);
+  pool.stateFor(diagram2);
+  pool.releaseUnusedStates();
+  pool.releaseUnusedStates();
+  assert(pool.nStates()==0);
+  assert(pool.nFreeStates()==1);
+}
+
+
+int main()
+{
+  testGettingTheSameState();
+  testReleasingUnusedStates();
+  testLimitingFreeStates();
+}
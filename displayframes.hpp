@@ -0,0 +1,46 @@
+#ifndef DISPLAYFRAMES_HPP_
+#define DISPLAYFRAMES_HPP_
+
+#include <vector>
+#include "scene.hpp"
+
+
+// Frames that stand in for the display frames of some scenes while
+// charmappers are applied.  Body positions are read from and written to
+// these instead, so several frames can be worked on at the same time.
+struct DisplayFrames {
+  struct Entry {
+    const Scene *scene_ptr;
+    Scene::Frame frame;
+  };
+
+  std::vector<Entry> entries;
+
+  Scene::Frame &frameFor(const Scene &scene)
+  {
+    for (Entry &entry : entries) {
+      if (entry.scene_ptr==&scene) {
+        return entry.frame;
+      }
+    }
+
+    assert(false);
+    return entries.front().frame;
+  }
+};
+
+
+// The frame that stands in for the scene's display frame, or the display
+// frame itself if there are no display frames.
+inline Scene::Frame &
+  displayFrameOf(Scene &scene,DisplayFrames *display_frames_ptr)
+{
+  if (display_frames_ptr) {
+    return display_frames_ptr->frameFor(scene);
+  }
+
+  return scene.displayFrame();
+}
+
+
+#endif /* DISPLAYFRAMES_HPP_ */
@@ -0,0 +1,178 @@
+#include "environment.hpp"
+
+using std::unique_ptr;
+using std::lock_guard;
+using std::mutex;
+
+
+struct EnvironmentLayout::Transition {
+  Symbol name;
+  unique_ptr<EnvironmentLayout> layout_ptr;
+};
+
+
+static mutex &layoutMutex()
+{
+  static mutex the_mutex;
+  return the_mutex;
+}
+
+
+EnvironmentLayout::~EnvironmentLayout()
+{
+}
+
+
+const EnvironmentLayout &EnvironmentLayout::empty()
+{
+  static EnvironmentLayout empty_layout;
+  return empty_layout;
+}
+
+
+const EnvironmentLayout &EnvironmentLayout::withName(const Symbol &name) const
+{
+  assert(slotIndex(name)<0);
+  lock_guard<mutex> lock(layoutMutex());
+
+  for (auto &transition : transitions) {
+    if (transition.name==name) {
+      return *transition.layout_ptr;
+    }
+  }
+
+  unique_ptr<EnvironmentLayout> new_layout_ptr(new EnvironmentLayout);
+  new_layout_ptr->names = names;
+  new_layout_ptr->names.push_back(name);
+  transitions.push_back(Transition{name,std::move(new_layout_ptr)});
+  return *transitions.back().layout_ptr;
+}
+
+
+int EnvironmentLayout::slotIndex(const Symbol &name) const
+{
+  int n_slots = nSlots();
+
+  for (int slot=0; slot!=n_slots; ++slot) {
+    if (names[slot]==name) {
+      return slot;
+    }
+  }
+
+  return -1;
+}
+
+
+Optional<EnvironmentSlot>
+  resolveVariable(const Symbol &name,const Environment *environment_ptr)
+{
+  int depth = 0;
+
+  while (environment_ptr) {
+    int slot = environment_ptr->layout().slotIndex(name);
+
+    if (slot>=0) {
+      return EnvironmentSlot{depth,slot};
+    }
+
+    environment_ptr = environment_ptr->parent_environment_ptr;
+    ++depth;
+  }
+
+  return {};
+}
+
+
+VariableLookupCache &
+  VariableLookupCache::operator=(const VariableLookupCache &)
+{
+  resolution_ptr = nullptr;
+  lock_guard<mutex> lock(resolutions_mutex);
+  resolution_ptrs.clear();
+  return *this;
+}
+
+
+const Any *
+  VariableLookupCache::maybeCachedValue(
+    const Resolution &resolution,
+    const Environment *environment_ptr
+  )
+{
+  int depth = resolution.environment_slot.depth;
+
+  for (int i=0; ; ++i) {
+    if (!environment_ptr) {
+      return nullptr;
+    }
+
+    if (environment_ptr->layout_ptr!=resolution.layout_ptrs[i]) {
+      return nullptr;
+    }
+
+    if (i==depth) {
+      break;
+    }
+
+    environment_ptr = environment_ptr->parent_environment_ptr;
+  }
+
+  return &environment_ptr->slot_values[resolution.environment_slot.slot];
+}
+
+
+const Any *
+  VariableLookupCache::maybeLookup(
+    const Symbol &name,
+    const Environment *environment_ptr
+  ) const
+{
+  const Resolution *cached_resolution_ptr =
+    resolution_ptr.load(std::memory_order_acquire);
+
+  if (cached_resolution_ptr) {
+    const Any *value_ptr =
+      maybeCachedValue(*cached_resolution_ptr,environment_ptr);
+
+    if (value_ptr) {
+      return value_ptr;
+    }
+  }
+
+  Optional<EnvironmentSlot> maybe_slot = resolveVariable(name,environment_ptr);
+
+  if (!maybe_slot) {
+    return nullptr;
+  }
+
+  unique_ptr<Resolution> new_resolution_ptr(new Resolution{*maybe_slot,{}});
+
+  {
+    const Environment *e = environment_ptr;
+
+    for (int i=0; i<=maybe_slot->depth; ++i) {
+      new_resolution_ptr->layout_ptrs.push_back(e->layout_ptr);
+      e = e->parent_environment_ptr;
+    }
+  }
+
+  const Any &value = slotValue(environment_ptr,*maybe_slot);
+
+  {
+    // If the same expression keeps being evaluated in different kinds
+    // of environments, we stop caching rather than using more memory.
+    const size_t max_resolutions = 8;
+
+    lock_guard<mutex> lock(resolutions_mutex);
+
+    if (resolution_ptrs.size()<max_resolutions) {
+      resolution_ptrs.push_back(std::move(new_resolution_ptr));
+      resolution_ptr.store(
+        resolution_ptrs.back().get(),
+        std::memory_order_release
+      );
+    }
+  }
+
+  return &value;
+}
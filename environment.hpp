@@ -1,13 +1,44 @@
 #ifndef ENVIRONMENT_HPP
 #define ENVIRONMENT_HPP
 
-#include <map>
 #include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
 #include "any.hpp"
+#include "symbol.hpp"
+
+
+// This gives the names of the variables in an environment in slot order.
+// Layouts are shared by all environments that had the same names added in
+// the same order, so two environments with the same layout pointer have
+// the same variables in the same slots.
+class EnvironmentLayout {
+  public:
+    EnvironmentLayout(const EnvironmentLayout &) = delete;
+    ~EnvironmentLayout();
+
+    static const EnvironmentLayout &empty();
+    const EnvironmentLayout &withName(const Symbol &name) const;
+    int nSlots() const { return names.size(); }
+    const Symbol &slotName(int slot) const { return names[slot]; }
+    int slotIndex(const Symbol &name) const;
+      // Returns -1 if the name is not in the layout.
+
+  private:
+    struct Transition;
+
+    EnvironmentLayout() = default;
+
+    std::vector<Symbol> names;
+    mutable std::vector<Transition> transitions;
+};
 
 
 struct Environment {
-  std::map<std::string,Any> map;
+  const EnvironmentLayout *layout_ptr = &EnvironmentLayout::empty();
+  std::vector<Any> slot_values;
   const Environment *parent_environment_ptr;
 
   Environment(const Environment* parent_environment_ptr_arg = nullptr)
@@ -15,30 +46,100 @@ struct Environment {
   {
   }
 
+  const EnvironmentLayout &layout() const { return *layout_ptr; }
+
   Any& operator[](const std::string &name)
   {
-    return map[name];
+    return operator[](Symbol(name));
+  }
+
+  Any& operator[](const Symbol &name)
+  {
+    int slot = layout().slotIndex(name);
+
+    if (slot>=0) {
+      return slot_values[slot];
+    }
+
+    layout_ptr = &layout().withName(name);
+    slot_values.emplace_back();
+    return slot_values.back();
   }
 };
 
 
-inline Optional<Any>
-  variableValue(const std::string &name,const Environment *environment_ptr)
+// Where a variable was found relative to the environment it was looked up
+// from.
+struct EnvironmentSlot {
+  int depth;
+  int slot;
+};
+
+
+extern Optional<EnvironmentSlot>
+  resolveVariable(const Symbol &name,const Environment *environment_ptr);
+
+inline const Any &
+  slotValue(const Environment *environment_ptr,const EnvironmentSlot &slot)
 {
-  if (!environment_ptr) {
-    return {};
+  for (int i=0; i!=slot.depth; ++i) {
+    assert(environment_ptr);
+    environment_ptr = environment_ptr->parent_environment_ptr;
   }
 
-  const Environment &environment = *environment_ptr;
+  assert(environment_ptr);
+  return environment_ptr->slot_values[slot.slot];
+}
+
 
-  auto iter = environment.map.find(name);
+inline Optional<Any>
+  variableValue(const Symbol &name,const Environment *environment_ptr)
+{
+  Optional<EnvironmentSlot> maybe_slot =
+    resolveVariable(name,environment_ptr);
 
-  if (iter==environment.map.end()) {
-    return variableValue(name,environment.parent_environment_ptr);
+  if (!maybe_slot) {
+    return {};
   }
 
-  return iter->second;
+  return Any(slotValue(environment_ptr,*maybe_slot));
 }
 
 
+// This remembers where a particular variable reference was found the last
+// time, along with the layouts of the environments that were searched, so
+// that looking up the variable again in environments with the same layouts
+// only requires following parent pointers and indexing.  It can be shared
+// between threads.
+class VariableLookupCache {
+  public:
+    VariableLookupCache() = default;
+
+    // Caches aren't part of the value of whatever holds them.
+    VariableLookupCache(const VariableLookupCache &) : VariableLookupCache() {}
+    VariableLookupCache &operator=(const VariableLookupCache &);
+
+    const Any *
+      maybeLookup(
+        const Symbol &name,
+        const Environment *environment_ptr
+      ) const;
+
+  private:
+    struct Resolution {
+      EnvironmentSlot environment_slot;
+      std::vector<const EnvironmentLayout *> layout_ptrs;
+    };
+
+    static const Any *
+      maybeCachedValue(const Resolution &,const Environment *environment_ptr);
+
+    mutable std::atomic<const Resolution *> resolution_ptr{nullptr};
+    mutable std::mutex resolutions_mutex;
+    mutable std::vector<std::unique_ptr<Resolution>> resolution_ptrs;
+      // Once published, resolutions must stay alive since other threads
+      // may still be reading them.
+};
+
+
 #endif /* ENVIRONMENT_HPP */
@@ -0,0 +1,80 @@
+#include "environment.hpp"
+
+#include <cassert>
+
+
+static void testSharedLayouts()
+{
+  Environment environment1;
+  environment1["x"] = 1;
+  environment1["y"] = 2;
+  Environment environment2;
+  environment2["x"] = 3;
+  environment2["y"] = 4;
+  assert(environment1.layout_ptr==environment2.layout_ptr);
+  assert(environment1.layout().slotName(1)==Symbol("y"));
+
+  Environment environment3;
+  environment3["y"] = 5;
+  environment3["x"] = 6;
+  assert(environment3.layout_ptr!=environment1.layout_ptr);
+
+  environment1["x"] = 7;
+  assert(environment1.layout_ptr==environment2.layout_ptr);
+  assert(*variableValue(Symbol("x"),&environment1)==Any(7));
+}
+
+
+static void testVariableValue()
+{
+  Environment outer_environment;
+  outer_environment["x"] = 1;
+  outer_environment["y"] = 2;
+  Environment inner_environment(&outer_environment);
+  inner_environment["x"] = 3;
+
+  assert(*variableValue(Symbol("x"),&inner_environment)==Any(3));
+  assert(*variableValue(Symbol("y"),&inner_environment)==Any(2));
+  assert(!variableValue(Symbol("z"),&inner_environment));
+
+  Optional<EnvironmentSlot> maybe_slot =
+    resolveVariable(Symbol("y"),&inner_environment);
+  assert(maybe_slot);
+  assert(maybe_slot->depth==1);
+  assert(maybe_slot->slot==1);
+}
+
+
+static void testLookupCache()
+{
+  VariableLookupCache cache;
+  Symbol y("y");
+  Environment outer_environment;
+  outer_environment["y"] = 2;
+  Environment inner_environment(&outer_environment);
+  inner_environment["x"] = 1;
+  assert(*cache.maybeLookup(y,&inner_environment)==Any(2));
+
+  // Same layouts, different values.
+  Environment outer_environment2;
+  outer_environment2["y"] = 4;
+  Environment inner_environment2(&outer_environment2);
+  inner_environment2["x"] = 3;
+  assert(*cache.maybeLookup(y,&inner_environment2)==Any(4));
+
+  // The variable is now shadowed, so the cached slot doesn't apply.
+  inner_environment2["y"] = 5;
+  assert(*cache.maybeLookup(y,&inner_environment2)==Any(5));
+
+  // The chain is shorter than before.
+  assert(*cache.maybeLookup(y,&outer_environment)==Any(2));
+  assert(!cache.maybeLookup(y,nullptr));
+}
+
+
+int main()
+{
+  testSharedLayouts();
+  testVariableValue();
+  testLookupCache();
+}
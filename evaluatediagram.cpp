@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <sstream>
+#include <algorithm>
 #include "linetext.hpp"
 #include "diagramio.hpp"
 #include "anyio.hpp"
@@ -12,70 +13,40 @@ using std::string;
 using std::vector;
 using std::ostringstream;
 using std::cerr;
-using Node = DiagramNode;
+using Schedule = Diagram::Schedule;
 
 
 namespace {
-struct LineRange {
-  const int begin_line_index;
-  const int end_line_index;
+// This is what evaluating a node uses besides the node states.  Nodes
+// which are evaluated at the same time each need their own.
+struct NodeScratch {
+  ostringstream &statement_error_stream;
+  vector<Any> &evaluation_stack;
+  vector<const Object::Method *> &method_stack;
+  vector<Any> &input_values;
+  ostream &debug_stream;
+  int n_node_evaluations = 0;
+  int n_memo_hits = 0;
+  int n_memo_misses = 0;
 };
 }
 
 
-static LineRange
-  statementLineRange(const Node &node,int desired_statement_index)
-{
-  int line_index = 0;
-  int statement_index = 0;
-
-  for (;;) {
-    int n_lines_in_statement = node.statements[statement_index].n_lines;
-    int next_line_index = line_index + n_lines_in_statement;
-
-    if (statement_index == desired_statement_index) {
-      return LineRange{line_index,next_line_index};
-    }
-
-    ++statement_index;
-    line_index = next_line_index;
-  }
-}
-
-
-static string
-  buildStatementString(const Node &node,int desired_statement_index)
-{
-  LineRange line_range = statementLineRange(node,desired_statement_index);
-  int line_index = line_range.begin_line_index;
-  int next_line_index = line_range.end_line_index;
-
-  string statement = "";
-
-  while (line_index != next_line_index) {
-    statement += node.lines[line_index].text + " ";
-    ++line_index;
-  }
-
-  return statement;
-}
-
-
 static void
   evaluateDiagramNodeStatement(
-    const Diagram &,
     DiagramEvaluationState &diagram_state,
-    const Node &node,
     DiagramEvaluationState::NodeState &node_state,
-    int statement_index,
-    int output_index,
+    const Schedule::Statement &scheduled_statement,
     Executor &executor,
-    const vector<Any> &input_values
+    NodeScratch &scratch
   )
 {
-  string statement = buildStatementString(node,statement_index);
+  const CompiledStatement &statement = *scheduled_statement.compiled_ptr;
+  int output_index = scheduled_statement.output_index;
 
-  ostringstream statement_error_stream;
+  const vector<Any> &input_values = scratch.input_values;
+  ostringstream &statement_error_stream = scratch.statement_error_stream;
+  assert(statement_error_stream.tellp()==0);
 
   auto allocate_environment_function =
     [&](const Environment *parent_environment_ptr) -> Environment& {
@@ -88,7 +59,9 @@ static void
       input_values,
       executor,
       statement_error_stream,
-      allocate_environment_function
+      allocate_environment_function,
+      scratch.evaluation_stack,
+      scratch.method_stack
     );
 
 #if 0
@@ -99,13 +72,16 @@ static void
   cerr << "result: " << maybe_output_value << "\n";
 #endif
 
-  {
-    LineRange line_range = statementLineRange(node,statement_index);
-    int begin = line_range.begin_line_index;
-    int end = line_range.end_line_index;
+  string statement_error;
+
+  if (statement_error_stream.tellp()!=0) {
+    statement_error = statement_error_stream.str();
+    statement_error_stream.str("");
+    int begin = scheduled_statement.first_line_index;
+    int end = begin + scheduled_statement.n_lines;
 
     for (int line_index = begin; line_index != end; ++line_index) {
-      node_state.line_errors[line_index] = statement_error_stream.str();
+      node_state.line_errors[line_index] = statement_error;
     }
   }
 
@@ -114,9 +90,9 @@ static void
       node_state.output_values[output_index] = *maybe_output_value;
     }
     else {
-      std::ostream &error_stream = executor.debugStream();
-      error_stream << "Error: " << statement_error_stream.str() << "\n";
-      error_stream << "  statement: " << statement << "\n";
+      std::ostream &error_stream = scratch.debug_stream;
+      error_stream << "Error: " << statement_error << "\n";
+      error_stream << "  statement: " << statement.text << "\n";
 
       for (int i=0, n_inputs=input_values.size(); i!=n_inputs; ++i) {
         error_stream << "input_values[" << i << "]=" << input_values[i] << "\n";
@@ -126,123 +102,710 @@ static void
 }
 
 
+// Whether we know that the two values are the same.  Objects and functions
+// can refer to things that change without the value changing, so we
+// never consider them to be the same.
+static bool valuesAreSame(const Any &a,const Any &b)
+{
+  if (a.isObject() || a.isFunction() || b.isObject() || b.isFunction()) {
+    return false;
+  }
+
+  if (a.isVector() && b.isVector()) {
+    const vector<Any> &a_elements = a.asVector();
+    const vector<Any> &b_elements = b.asVector();
+    int n = a_elements.size();
+
+    if (int(b_elements.size())!=n) {
+      return false;
+    }
+
+    for (int i=0; i!=n; ++i) {
+      if (!valuesAreSame(a_elements[i],b_elements[i])) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  return a==b;
+}
+
+
+static bool valuesAreSame(const vector<Any> &a,const vector<Any> &b)
+{
+  int n = a.size();
+
+  if (int(b.size())!=n) {
+    return false;
+  }
+
+  for (int i=0; i!=n; ++i) {
+    if (!valuesAreSame(a[i],b[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+static void combineHash(size_t &hash,size_t value)
+{
+  hash ^= value + 0x9e3779b9 + (hash<<6) + (hash>>2);
+}
+
+
+// Vectors and float vectors with the same elements give the same hash,
+// since they are considered the same.
+static bool maybeHashValue(const Any &value,size_t &hash)
+{
+  if (value.isVoid()) {
+    combineHash(hash,0);
+    return true;
+  }
+
+  if (value.isFloat()) {
+    combineHash(hash,std::hash<float>()(value.asFloat()));
+    return true;
+  }
+
+  if (value.isString()) {
+    combineHash(hash,std::hash<string>()(value.asString()));
+    return true;
+  }
+
+  if (value.isFloatVector()) {
+    const FloatVector &elements = value.asFloatVector();
+    combineHash(hash,elements.size());
+
+    for (float element : elements) {
+      combineHash(hash,std::hash<float>()(element));
+    }
+
+    return true;
+  }
+
+  if (value.isVector()) {
+    const vector<Any> &elements = value.asVector();
+    combineHash(hash,elements.size());
+
+    for (const Any &element : elements) {
+      if (!maybeHashValue(element,hash)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Objects and functions are never the same as anything else, and
+  // classes can only be reached through variables.
+  return false;
+}
+
+
+static bool maybeHashValues(const vector<Any> &values,size_t &hash)
+{
+  hash = values.size();
+
+  for (const Any &value : values) {
+    if (!maybeHashValue(value,hash)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+template <typename Function>
 static void
-  updateNodeEvaluation(
-    const Diagram &diagram,
-    DiagramEvaluationState &diagram_state,
-    int node_index,
-    vector<bool> &evaluated_flags,
-    Executor &executor
+  forEachVariableName(
+    const Schedule &schedule,
+    const Schedule::Step &step,
+    const Function &f
+  )
+{
+  for (int i=0; i!=step.n_statements; ++i) {
+    const CompiledStatement &statement =
+      *schedule.statements[step.first_statement + i].compiled_ptr;
+
+    for (const auto &variable : statement.expression.variables) {
+      f(variable.name);
+    }
+  }
+}
+
+
+// A pure node's outputs only depend on its input values, since it doesn't
+// read any variables, and variables are the only way to get to things like
+// the scene.
+static bool nodeIsPure(const Schedule::Step &step)
+{
+  return !step.reads_variables && !step.has_effects;
+}
+
+
+static bool
+  statementIsEvaluated(
+    const DiagramOptimization::Node *optimized_node_ptr,
+    int statement_index
+  )
+{
+  return
+    !optimized_node_ptr ||
+    optimized_node_ptr->needed_statements[statement_index];
+}
+
+
+static void
+  setEvaluatedStatements(
+    vector<bool> &evaluated_statements,
+    const Schedule::Step &step,
+    const DiagramOptimization::Node *optimized_node_ptr
+  )
+{
+  int n_statements = step.n_statements;
+  evaluated_statements.resize(n_statements);
+
+  for (int i=0; i!=n_statements; ++i) {
+    evaluated_statements[i] = statementIsEvaluated(optimized_node_ptr,i);
+  }
+}
+
+
+// Results can only be reused if they were computed by evaluating the
+// same statements.
+static bool
+  sameStatementsAreEvaluated(
+    const vector<bool> &evaluated_statements,
+    const Schedule::Step &step,
+    const DiagramOptimization::Node *optimized_node_ptr
+  )
+{
+  int n_statements = step.n_statements;
+
+  if (int(evaluated_statements.size())!=n_statements) {
+    return false;
+  }
+
+  for (int i=0; i!=n_statements; ++i) {
+    bool is_evaluated = statementIsEvaluated(optimized_node_ptr,i);
+
+    if (evaluated_statements[i]!=is_evaluated) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+static DiagramEvaluationState::MemoEntry *
+  findMemoEntry(
+    DiagramEvaluationState::NodeState &node_state,
+    const Schedule::Step &step,
+    const DiagramOptimization::Node *optimized_node_ptr,
+    size_t input_hash,
+    const vector<Any> &input_values
+  )
+{
+  for (DiagramEvaluationState::MemoEntry &entry : node_state.memo_entries) {
+    if (
+      entry.input_hash==input_hash &&
+      entry.node_revision==step.node_revision &&
+      sameStatementsAreEvaluated(
+        entry.evaluated_statements,step,optimized_node_ptr
+      ) &&
+      valuesAreSame(entry.input_values,input_values)
+    ) {
+      return &entry;
+    }
+  }
+
+  return nullptr;
+}
+
+
+static void
+  addMemoEntry(
+    DiagramEvaluationState::NodeState &node_state,
+    const Schedule::Step &step,
+    const DiagramOptimization::Node *optimized_node_ptr,
+    size_t input_hash,
+    const vector<Any> &input_values,
+    int max_memo_entries
+  )
+{
+  vector<DiagramEvaluationState::MemoEntry> &entries = node_state.memo_entries;
+
+  // Entries for older text will never be used again.
+  entries.erase(
+    std::remove_if(
+      entries.begin(),
+      entries.end(),
+      [&](const DiagramEvaluationState::MemoEntry &entry){
+        return entry.node_revision!=step.node_revision;
+      }
+    ),
+    entries.end()
   );
 
+  if (max_memo_entries<=0) {
+    return;
+  }
+
+  int entry_index = node_state.next_memo_entry_index;
+
+  if (int(entries.size())<max_memo_entries) {
+    entry_index = entries.size();
+    entries.emplace_back();
+  }
+  else {
+    // Replace the entries in turn.
+    entry_index %= entries.size();
+    node_state.next_memo_entry_index = entry_index + 1;
+  }
+
+  DiagramEvaluationState::MemoEntry &entry = entries[entry_index];
+  entry.input_hash = input_hash;
+  entry.node_revision = step.node_revision;
+  setEvaluatedStatements(entry.evaluated_statements,step,optimized_node_ptr);
+  entry.input_values = input_values;
+  entry.output_values = node_state.output_values;
+  entry.line_errors = node_state.line_errors;
+}
+
+
+static bool
+  variablesAreUnchanged(
+    const Schedule &schedule,
+    const Schedule::Step &step,
+    const DiagramEvaluationState::NodeState &node_state,
+    const Executor &executor
+  )
+{
+  int n_variable_values = node_state.variable_values.size();
+  int variable_index = 0;
+  bool is_unchanged = true;
+
+  forEachVariableName(schedule,step,[&](const Symbol &name){
+    if (!is_unchanged) {
+      return;
+    }
+
+    if (variable_index==n_variable_values) {
+      is_unchanged = false;
+      return;
+    }
+
+    const DiagramEvaluationState::VariableValue &old_value =
+      node_state.variable_values[variable_index];
+
+    ++variable_index;
+
+    Optional<EnvironmentSlot> maybe_slot =
+      resolveVariable(name,executor.parent_environment_ptr);
+
+    if (!maybe_slot) {
+      is_unchanged = !old_value.was_found;
+      return;
+    }
+
+    is_unchanged =
+      old_value.was_found &&
+      valuesAreSame(
+        old_value.value,
+        slotValue(executor.parent_environment_ptr,*maybe_slot)
+      );
+  });
+
+  return is_unchanged && variable_index==n_variable_values;
+}
+
+
+static void
+  rememberWhatNodeWasComputedFrom(
+    DiagramEvaluationState::NodeState &node_state,
+    const Schedule &schedule,
+    const Schedule::Step &step,
+    const DiagramOptimization::Node *optimized_node_ptr,
+    const Executor &executor,
+    const vector<Any> &input_values
+  )
+{
+  node_state.is_reusable = true;
+  node_state.node_revision = step.node_revision;
+
+  setEvaluatedStatements(
+    node_state.evaluated_statements,step,optimized_node_ptr
+  );
+
+  node_state.input_values = input_values;
+  node_state.variable_values.clear();
+
+  forEachVariableName(schedule,step,[&](const Symbol &name){
+    node_state.variable_values.emplace_back();
+
+    DiagramEvaluationState::VariableValue &variable_value =
+      node_state.variable_values.back();
+
+    Optional<Any> maybe_value =
+      variableValue(name,executor.parent_environment_ptr);
+
+    if (maybe_value) {
+      variable_value.was_found = true;
+      variable_value.value = std::move(*maybe_value);
+    }
+  });
+}
+
 
 static void
   evaluateNode(
-    const Diagram &diagram,
     DiagramEvaluationState &diagram_state,
-    const Node &node,
-    DiagramEvaluationState::NodeState &node_state,
-    vector<bool> &evaluated_flags,
-    Executor &executor
+    const Schedule &schedule,
+    const Schedule::Step &step,
+    Executor &executor,
+    const DiagramOptimization::Node *optimized_node_ptr,
+    NodeScratch &scratch
   )
 {
-  int n_inputs = node.inputs.size();
+  vector<Any> &input_values = scratch.input_values;
+  DiagramEvaluationState::NodeState &node_state =
+    diagram_state.node_states[step.node_index];
 
-  for (int i=0; i!=n_inputs; ++i) {
-    int source_node_index = node.inputs[i].source_node_index;
+  input_values.clear();
 
-    if (source_node_index>=0) {
-      updateNodeEvaluation(
-        diagram,
-        diagram_state,
-        source_node_index,
-        evaluated_flags,
-        executor
+  for (int i=0; i!=step.n_inputs; ++i) {
+    const Schedule::InputSlot &slot =
+      schedule.input_slots[step.first_input_slot + i];
+
+    int source_node = slot.source_node_index;
+    bool is_needed =
+      !optimized_node_ptr || optimized_node_ptr->needed_inputs[i];
+
+    if (source_node>=0 && is_needed) {
+      // The source node comes earlier in the schedule, so it has already
+      // been evaluated.
+      input_values.push_back(
+        diagram_state
+        .node_states[source_node]
+        .output_values[slot.source_output_index]
       );
     }
+    else {
+      input_values.emplace_back();
+    }
   }
 
-  int n_statements = node.statements.size();
-  int next_output_index = 0;
-  int n_outputs = node.nOutputs();
-  int n_lines = node.nLines();
+  // Nodes that have effects have to be evaluated every time, so we can
+  // only reuse the previous state of nodes that just compute values.
+  bool can_reuse = !step.has_effects;
+
+  if (
+    can_reuse &&
+    node_state.is_reusable &&
+    node_state.node_revision==step.node_revision &&
+    sameStatementsAreEvaluated(
+      node_state.evaluated_statements,step,optimized_node_ptr
+    ) &&
+    valuesAreSame(node_state.input_values,input_values) &&
+    variablesAreUnchanged(schedule,step,node_state,executor)
+  ) {
+    return;
+  }
 
-  assert(node_state.output_values.empty());
-  assert(node_state.line_errors.empty());
-    // We are assuming that the node state has been cleared before calling
-    // this so that we're starting with a clean state.
+  size_t input_hash = 0;
 
-  node_state.output_values.resize(n_outputs);
-  node_state.line_errors.resize(n_lines);
+  bool can_memoize =
+    can_reuse && nodeIsPure(step) && maybeHashValues(input_values,input_hash);
 
-  vector<Any> input_values;
+  if (can_memoize) {
+    const DiagramEvaluationState::MemoEntry *entry_ptr =
+      findMemoEntry(
+        node_state,step,optimized_node_ptr,input_hash,input_values
+      );
 
-  for (int i=0; i!=n_inputs; ++i) {
-    int source_node = node.inputs[i].source_node_index;
-    int source_output_index = node.inputs[i].source_output_index;
-    Any source_value;
+    if (entry_ptr) {
+      ++scratch.n_memo_hits;
+      node_state.output_values = entry_ptr->output_values;
+      node_state.line_errors = entry_ptr->line_errors;
 
-    if (source_node>=0 && source_output_index>=0) {
-      source_value =
-        diagram_state
-        .node_states[source_node]
-        .output_values[source_output_index];
+      rememberWhatNodeWasComputedFrom(
+        node_state,schedule,step,optimized_node_ptr,executor,input_values
+      );
+
+      return;
     }
 
-    input_values.push_back(source_value);
+    ++scratch.n_memo_misses;
   }
 
+  ++scratch.n_node_evaluations;
+  node_state.output_values.assign(step.n_outputs,Any());
+  node_state.line_errors.assign(step.n_lines,string());
+
   for (
     int statement_index=0;
-    statement_index!=n_statements;
+    statement_index!=step.n_statements;
     ++statement_index
   ) {
-    int output_index = -1;
-
-    if (node.statements[statement_index].has_output) {
-      output_index = next_output_index;
-      ++next_output_index;
+    if (!statementIsEvaluated(optimized_node_ptr,statement_index)) {
+      continue;
     }
 
     evaluateDiagramNodeStatement(
-      diagram,
       diagram_state,
-      node,
       node_state,
-      statement_index,
-      output_index,
+      schedule.statements[step.first_statement + statement_index],
       executor,
-      input_values
+      scratch
+    );
+  }
+
+  if (can_reuse) {
+    rememberWhatNodeWasComputedFrom(
+      node_state,schedule,step,optimized_node_ptr,executor,input_values
     );
   }
+  else {
+    node_state.is_reusable = false;
+  }
+
+  if (can_memoize) {
+    addMemoEntry(
+      node_state,
+      step,
+      optimized_node_ptr,
+      input_hash,
+      input_values,
+      diagram_state.max_memo_entries_per_node
+    );
+  }
+}
+
+
+// Split the schedule into waves, where the nodes in each wave only depend
+// on nodes in earlier waves.  A node with effects gets a wave of its own,
+// which comes after everything before it in the schedule and before
+// everything after it, so the effects happen in the same order and each
+// node sees the same environment as when evaluating one node at a time.
+static vector<vector<int>>
+  scheduleWaves(const Diagram &diagram,const Schedule &schedule)
+{
+  vector<int> node_waves(diagram.nNodes(),0);
+  vector<vector<int>> waves;
+  int first_free_wave = 0;
+  int n_steps = schedule.steps.size();
+
+  for (int step_index=0; step_index!=n_steps; ++step_index) {
+    const Schedule::Step &step = schedule.steps[step_index];
+    int wave = first_free_wave;
+
+    if (step.has_effects) {
+      wave = waves.size();
+      first_free_wave = wave + 1;
+    }
+    else {
+      for (int i=0; i!=step.n_inputs; ++i) {
+        const Schedule::InputSlot &slot =
+          schedule.input_slots[step.first_input_slot + i];
+
+        if (slot.source_node_index>=0) {
+          wave = std::max(wave,node_waves[slot.source_node_index] + 1);
+        }
+      }
+    }
+
+    node_waves[step.node_index] = wave;
+
+    if (int(waves.size())<=wave) {
+      waves.resize(wave + 1);
+    }
+
+    waves[wave].push_back(step_index);
+  }
+
+  return waves;
+}
+
+
+namespace {
+struct ThreadScratch {
+  ostringstream statement_error_stream;
+  vector<Any> evaluation_stack;
+  vector<const Object::Method *> method_stack;
+  vector<Any> input_values;
+  ostringstream debug_stream;
+  int n_node_evaluations = 0;
+  int n_memo_hits = 0;
+  int n_memo_misses = 0;
+
+  NodeScratch nodeScratch()
+  {
+    return {
+      statement_error_stream,
+      evaluation_stack,
+      method_stack,
+      input_values,
+      debug_stream
+    };
+  }
+};
 }
 
 
 static void
-  updateNodeEvaluation(
+  evaluateDiagramInParallel(
     const Diagram &diagram,
+    Executor &executor,
     DiagramEvaluationState &diagram_state,
-    int node_index,
-    vector<bool> &evaluated_flags,
-    Executor &executor
+    NodeScratch &scratch,
+    ThreadPool &thread_pool
   )
 {
-  assert(node_index>=0);
+  const Schedule &schedule = diagram.schedule();
+  vector<ThreadScratch> thread_scratches(thread_pool.nThreads());
+  vector<string> debug_texts;
 
-  if (evaluated_flags[node_index]) {
-    return;
+  for (const vector<int> &wave : scheduleWaves(diagram,schedule)) {
+    int n_wave_steps = wave.size();
+
+    if (n_wave_steps==1) {
+      const Schedule::Step &step = schedule.steps[wave[0]];
+
+      evaluateNode(
+        diagram_state,
+        schedule,
+        step,
+        executor,
+        /*optimized_node_ptr*/nullptr,
+        scratch
+      );
+
+      continue;
+    }
+
+    // Nothing in this wave has effects, so the nodes can be evaluated in
+    // any order.
+    debug_texts.assign(n_wave_steps,string());
+
+    thread_pool.run(n_wave_steps,[&](int task_index,int thread_index){
+      const Schedule::Step &step = schedule.steps[wave[task_index]];
+      ThreadScratch &thread_scratch = thread_scratches[thread_index];
+      NodeScratch node_scratch = thread_scratch.nodeScratch();
+
+      evaluateNode(
+        diagram_state,
+        schedule,
+        step,
+        executor,
+        /*optimized_node_ptr*/nullptr,
+        node_scratch
+      );
+
+      thread_scratch.n_node_evaluations += node_scratch.n_node_evaluations;
+      thread_scratch.n_memo_hits += node_scratch.n_memo_hits;
+      thread_scratch.n_memo_misses += node_scratch.n_memo_misses;
+
+      if (thread_scratch.debug_stream.tellp()!=0) {
+        debug_texts[task_index] = thread_scratch.debug_stream.str();
+        thread_scratch.debug_stream.str("");
+      }
+    });
+
+    for (const string &debug_text : debug_texts) {
+      scratch.debug_stream << debug_text;
+    }
   }
 
-  evaluateNode(
+  for (const ThreadScratch &thread_scratch : thread_scratches) {
+    scratch.n_node_evaluations += thread_scratch.n_node_evaluations;
+    scratch.n_memo_hits += thread_scratch.n_memo_hits;
+    scratch.n_memo_misses += thread_scratch.n_memo_misses;
+  }
+}
+
+
+static void
+  evaluateDiagram(
+    const Diagram &diagram,
+    Executor &executor,
+    DiagramEvaluationState &diagram_state,
+    const DiagramOptimization *optimization_ptr,
+    ThreadPool *thread_pool_ptr
+  )
+{
+  const Schedule &schedule = diagram.schedule();
+  vector<Any> input_values;
+
+  NodeScratch scratch{
+    diagram_state.statement_error_stream,
+    diagram_state.evaluation_stack,
+    diagram_state.method_stack,
+    input_values,
+    executor.debugStream()
+  };
+
+  // The node states are kept from the previous evaluation so that nodes
+  // whose text, inputs and variables haven't changed can keep their
+  // results.  Environments only live for one evaluation though.
+  diagram_state.releaseEnvironments();
+  diagram_state.node_states.resize(diagram.nNodes());
+
+  if (thread_pool_ptr) {
+    assert(!optimization_ptr);
+
+    evaluateDiagramInParallel(
+      diagram,executor,diagram_state,scratch,*thread_pool_ptr
+    );
+  }
+  else {
+    for (const Schedule::Step &step : schedule.steps) {
+      const DiagramOptimization::Node *optimized_node_ptr = nullptr;
+
+      if (optimization_ptr) {
+        optimized_node_ptr = &optimization_ptr->nodes[step.node_index];
+
+        if (!optimized_node_ptr->is_needed) {
+          continue;
+        }
+      }
+
+      evaluateNode(
+        diagram_state,
+        schedule,
+        step,
+        executor,
+        optimized_node_ptr,
+        scratch
+      );
+    }
+  }
+
+  diagram_state.n_node_evaluations += scratch.n_node_evaluations;
+  diagram_state.n_memo_hits += scratch.n_memo_hits;
+  diagram_state.n_memo_misses += scratch.n_memo_misses;
+}
+
+
+void
+  evaluateDiagram(
+    const Diagram &diagram,
+    Executor &executor,
+    DiagramEvaluationState &diagram_state
+  )
+{
+  evaluateDiagram(
     diagram,
+    executor,
     diagram_state,
-    diagram.node(node_index),
-    diagram_state.node_states[node_index],
-    evaluated_flags,
-    executor
+    /*optimization_ptr*/nullptr,
+    /*thread_pool_ptr*/nullptr
   );
-
-  evaluated_flags[node_index] = true;
 }
 
 
@@ -250,16 +813,35 @@ void
   evaluateDiagram(
     const Diagram &diagram,
     Executor &executor,
-    DiagramEvaluationState &diagram_state
+    DiagramEvaluationState &diagram_state,
+    const DiagramOptimization &optimization
   )
 {
-  int n_nodes = diagram.nNodes();
-  vector<bool> evaluated_flags(n_nodes,false);
-  diagram_state.node_states.resize(n_nodes);
+  evaluateDiagram(
+    diagram,
+    executor,
+    diagram_state,
+    &optimization,
+    /*thread_pool_ptr*/nullptr
+  );
+}
 
-  for (auto i : diagram.existingNodeIndices()) {
-    updateNodeEvaluation(diagram,diagram_state,i,evaluated_flags,executor);
-  }
+
+void
+  evaluateDiagram(
+    const Diagram &diagram,
+    Executor &executor,
+    DiagramEvaluationState &diagram_state,
+    ThreadPool &thread_pool
+  )
+{
+  evaluateDiagram(
+    diagram,
+    executor,
+    diagram_state,
+    /*optimization_ptr*/nullptr,
+    &thread_pool
+  );
 }
 
 
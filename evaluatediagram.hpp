@@ -1,9 +1,38 @@
 #include "diagram.hpp"
 #include "executor.hpp"
 #include "diagramevaluationstate.hpp"
+#include "optimizediagram.hpp"
+#include "threadpool.hpp"
 
 
 extern void evaluateDiagram(const Diagram &,Executor &);
 
+// The state can be kept from one evaluation to the next.  Nodes which
+// only compute values keep their previous state if their text, their
+// input values and the values of the variables that they read are the
+// same as last time.
 extern void
   evaluateDiagram(const Diagram &,Executor &,DiagramEvaluationState &);
+
+// This only evaluates the statements that the optimization says are
+// needed.  The states of the nodes that are skipped are left empty, and
+// statements that are skipped have no output values or errors.
+extern void
+  evaluateDiagram(
+    const Diagram &,
+    Executor &,
+    DiagramEvaluationState &,
+    const DiagramOptimization &
+  );
+
+// This evaluates nodes that don't depend on each other at the same time
+// using the threads in the pool.  Nodes with shows, returns or assignments
+// are still evaluated one at a time in the usual order, so the results are
+// the same as evaluating one node at a time.
+extern void
+  evaluateDiagram(
+    const Diagram &,
+    Executor &,
+    DiagramEvaluationState &,
+    ThreadPool &
+  );
@@ -266,6 +266,25 @@ static void testLocalVariableWithError()
 }
 
 
+static void testErrorsOnlyOnFailingLines()
+{
+  string node_text = "1\nx\n[y,\n2]\n3\n";
+  SingleNodeTester tester(node_text);
+  tester.doEvaluation();
+  vector<string> &line_errors = tester.lineErrors();
+  assert(line_errors[0] == "");
+  assert(line_errors[1] == "Unknown name: x\n");
+  assert(line_errors[2] == "Unknown name: y\n");
+  assert(line_errors[3] == "Unknown name: y\n");
+  assert(line_errors[4] == "");
+
+  // Evaluating again gives the same errors.
+  tester.diagram_state.clear();
+  tester.doEvaluation();
+  assert(tester.lineErrors() == line_errors);
+}
+
+
 static void testStatementsCoveringMultipleLines()
 {
   string node_text = "[1,\n2]";
@@ -276,6 +295,246 @@ static void testStatementsCoveringMultipleLines()
 }
 
 
+static void testOptimizedEvaluation()
+{
+  Tester tester;
+  Diagram &diagram = tester.diagram;
+  NodeIndex x_node = diagram.createNodeWithText("x");
+  NodeIndex unused_node = diagram.createNodeWithText("y");
+  NodeIndex add_node = diagram.createNodeWithText("$+1\nz");
+  NodeIndex return_node = diagram.createNodeWithText("return $");
+  diagram.connectNodes(x_node,0,add_node,0);
+  diagram.connectNodes(add_node,0,return_node,0);
+  tester.environment["x"] = 5;
+
+  evaluateDiagram(
+    diagram,tester.executor,tester.diagram_state,optimizeDiagram(diagram)
+  );
+
+  assert(*tester.maybeReturnValue()==6);
+
+  // The skipped statements would have given errors, since y and z
+  // aren't defined.
+  vector<DiagramEvaluationState::NodeState> &node_states =
+    tester.diagram_state.node_states;
+
+  assert(node_states[unused_node].line_errors.empty());
+  assert(node_states[add_node].line_errors[1]=="");
+  assert(tester.error_stream.str()=="");
+}
+
+
+static void testReusingOptimizedResults()
+{
+  Tester tester;
+  Diagram &diagram = tester.diagram;
+  DiagramEvaluationState &diagram_state = tester.diagram_state;
+  NodeIndex five_node = diagram.createNodeWithText("5");
+  NodeIndex add_node = diagram.createNodeWithText("$+1\n7");
+  NodeIndex return_node = diagram.createNodeWithText("return $");
+  diagram.connectNodes(five_node,0,add_node,0);
+  diagram.connectNodes(add_node,0,return_node,0);
+  DiagramOptimization optimization = optimizeDiagram(diagram);
+
+  evaluateDiagram(diagram,tester.executor,diagram_state,optimization);
+  assert(diagram_state.n_node_evaluations==3);
+  evaluateDiagram(diagram,tester.executor,diagram_state,optimization);
+  assert(diagram_state.n_node_evaluations==4);
+  assert(*tester.maybeReturnValue()==6);
+
+  // The skipped statement is needed now, so the node is evaluated again.
+  tester.doEvaluation();
+  assert(diagram_state.n_node_evaluations==6);
+  assert(diagram_state.node_states[add_node].output_values[1]==7);
+}
+
+
+static void testLongChain()
+{
+  Tester tester;
+  Diagram &diagram = tester.diagram;
+  int n_nodes = 20000;
+  NodeIndex previous_node = diagram.createNodeWithText("0");
+
+  for (int i=1; i!=n_nodes; ++i) {
+    NodeIndex node = diagram.createNodeWithText("$+1");
+    diagram.connectNodes(previous_node,0,node,0);
+    previous_node = node;
+  }
+
+  NodeIndex return_node = diagram.createNodeWithText("return $");
+  diagram.connectNodes(previous_node,0,return_node,0);
+  assert(evaluateDiagramReturningFloat(tester)==n_nodes - 1);
+}
+
+
+static void testReevaluatingOnlyWhatChanged()
+{
+  Tester tester;
+  Diagram &diagram = tester.diagram;
+  DiagramEvaluationState &diagram_state = tester.diagram_state;
+  NodeIndex x_node = diagram.createNodeWithText("x");
+  NodeIndex add_node = diagram.createNodeWithText("$+1");
+  NodeIndex constant_node = diagram.createNodeWithText("5");
+  NodeIndex multiply_node = diagram.createNodeWithText("$*2");
+  NodeIndex return_node = diagram.createNodeWithText("return $");
+  diagram.connectNodes(x_node,0,add_node,0);
+  diagram.connectNodes(constant_node,0,multiply_node,0);
+  diagram.connectNodes(add_node,0,return_node,0);
+  tester.environment["x"] = 1;
+
+  auto nEvaluatedNodes = [&]{
+    int old_n_node_evaluations = diagram_state.n_node_evaluations;
+    tester.doEvaluation();
+    return diagram_state.n_node_evaluations - old_n_node_evaluations;
+  };
+
+  assert(nEvaluatedNodes()==5);
+  assert(*tester.maybeReturnValue()==2);
+
+  // Nothing changed, but the return has to happen again.
+  assert(nEvaluatedNodes()==1);
+  assert(*tester.maybeReturnValue()==2);
+
+  // Only the nodes that depend on x are affected.
+  tester.environment["x"] = 2;
+  assert(nEvaluatedNodes()==3);
+  assert(*tester.maybeReturnValue()==3);
+
+  // Changing the text only affects that node and what depends on it.
+  diagram.setNodeText(multiply_node,"$*3");
+  assert(nEvaluatedNodes()==2);
+  assert(diagram_state.node_states[multiply_node].output_values[0]==15);
+
+  // Rewiring an input gives the node a different input value.
+  diagram.connectNodes(constant_node,0,add_node,0);
+  assert(nEvaluatedNodes()==2);
+  assert(*tester.maybeReturnValue()==6);
+  assert(diagram_state.node_states[x_node].output_values[0]==2);
+}
+
+
+static void testMemoizingPureNodes()
+{
+  Tester tester;
+  Diagram &diagram = tester.diagram;
+  DiagramEvaluationState &diagram_state = tester.diagram_state;
+  NodeIndex x_node = diagram.createNodeWithText("x");
+  NodeIndex multiply_node = diagram.createNodeWithText("$*2");
+  NodeIndex add_node = diagram.createNodeWithText("$+y");
+  NodeIndex show_node = diagram.createNodeWithText("show($)");
+  diagram.connectNodes(x_node,0,multiply_node,0);
+  diagram.connectNodes(multiply_node,0,add_node,0);
+  diagram.connectNodes(add_node,0,show_node,0);
+  tester.environment["y"] = 0.0f;
+
+  auto evaluateWithX = [&](float x){
+    tester.environment["x"] = x;
+    tester.doEvaluation();
+  };
+
+  // Only the multiply node is pure, since the add node reads a variable.
+  evaluateWithX(1);
+  evaluateWithX(2);
+  assert(diagram_state.n_memo_hits==0);
+  assert(diagram_state.n_memo_misses==2);
+
+  evaluateWithX(1);
+  evaluateWithX(2);
+  assert(diagram_state.n_memo_hits==2);
+  assert(diagram_state.n_memo_misses==2);
+  assert(diagram_state.node_states[multiply_node].output_values[0]==4);
+  assert(tester.show_stream.str()=="2\n4\n2\n4\n");
+
+  // Old results aren't used after the text changes.
+  diagram.setNodeText(multiply_node,"$*3");
+  evaluateWithX(2);
+  assert(diagram_state.n_memo_misses==3);
+  assert(diagram_state.node_states[multiply_node].output_values[0]==6);
+
+  // Only a limited number of results are kept.
+  diagram_state.max_memo_entries_per_node = 2;
+
+  for (float x : {3,4,5,6}) {
+    evaluateWithX(x);
+  }
+
+  assert(diagram_state.node_states[multiply_node].memo_entries.size()==2);
+}
+
+
+static void buildWideDiagram(Diagram &diagram)
+{
+  NodeIndex x_node = diagram.createNodeWithText("x");
+  diagram.createNodeWithText("a=x+1");
+  int n_branches = 50;
+  string sum_text = "$";
+
+  for (int i=1; i!=n_branches; ++i) {
+    sum_text += "+$";
+  }
+
+  NodeIndex sum_node = diagram.createNodeWithText(sum_text);
+
+  for (int i=0; i!=n_branches; ++i) {
+    NodeIndex branch_node =
+      diagram.createNodeWithText("$*" + std::to_string(i) + "+a");
+
+    diagram.connectNodes(x_node,0,branch_node,0);
+    diagram.connectNodes(branch_node,0,sum_node,i);
+  }
+
+  NodeIndex show_node = diagram.createNodeWithText("show($)");
+  diagram.createNodeWithText("show(a)");
+  NodeIndex return_node = diagram.createNodeWithText("return $");
+  diagram.connectNodes(sum_node,0,show_node,0);
+  diagram.connectNodes(sum_node,0,return_node,0);
+}
+
+
+static void testParallelEvaluation()
+{
+  Tester serial_tester;
+  Tester parallel_tester;
+  buildWideDiagram(serial_tester.diagram);
+  buildWideDiagram(parallel_tester.diagram);
+  serial_tester.environment["x"] = 2;
+  parallel_tester.environment["x"] = 2;
+  ThreadPool thread_pool(4);
+
+  serial_tester.doEvaluation();
+
+  evaluateDiagram(
+    parallel_tester.diagram,
+    parallel_tester.executor,
+    parallel_tester.diagram_state,
+    thread_pool
+  );
+
+  // The sum of 2*i+3 for i from 0 to 49.
+  assert(*serial_tester.maybeReturnValue()==2600);
+  assert(*parallel_tester.maybeReturnValue()==2600);
+  assert(parallel_tester.show_stream.str()==serial_tester.show_stream.str());
+  assert(serial_tester.show_stream.str()=="2600\n3\n");
+
+  const Diagram &diagram = serial_tester.diagram;
+
+  for (NodeIndex node_index : diagram.existingNodeIndices()) {
+    const DiagramEvaluationState::NodeState &serial_node_state =
+      serial_tester.diagram_state.node_states[node_index];
+
+    const DiagramEvaluationState::NodeState &parallel_node_state =
+      parallel_tester.diagram_state.node_states[node_index];
+
+    assert(
+      parallel_node_state.output_values==serial_node_state.output_values
+    );
+
+    assert(parallel_node_state.line_errors==serial_node_state.line_errors);
+  }
+}
+
+
 int main()
 {
   testSimpleReturn();
@@ -288,4 +547,11 @@ int main()
   testLocalVariable();
   testLocalVariableWithError();
   testStatementsCoveringMultipleLines();
+  testErrorsOnlyOnFailingLines();
+  testOptimizedEvaluation();
+  testReusingOptimizedResults();
+  testLongChain();
+  testReevaluatingOnlyWhatChanged();
+  testParallelEvaluation();
+  testMemoizingPureNodes();
 }
@@ -1,43 +1,25 @@
 #include "evaluateexpression.hpp"
 
-#include "maybepoint2d.hpp"
 #include "anyio.hpp"
 #include "maybeint.hpp"
 #include "expressionparser.hpp"
+#include "anyoperations.hpp"
 #include "rangetext.hpp"
 
 using std::vector;
 using std::cerr;
 using std::string;
 using std::ostream;
-using std::map;
-
-static Optional<Any>
-  maybeScaleVector(
-    float first_float,
-    const vector<Any> &second_vector,
-    ostream &error_stream
-  )
-{
-  vector<Any> result;
-
-  for (auto &x : second_vector) {
-    if (!x.isFloat()) {
-      error_stream << "Invalid vector for scalar multiplication.\n";
-      return {};
-    }
-
-    result.push_back(first_float*x.asFloat());
-  }
-
-  return {std::move(result)};
-}
 
 
+// This evaluates expressions while they are being parsed.  It is kept
+// as the reference for what the compiled form should produce.
 namespace {
 struct Evaluator : EvaluatorInterface {
   const ExpressionEvaluatorData &data;
   vector<Any> stack;
+  ArgumentNames argument_names;
+    // The names of the arguments of the calls that are being evaluated.
 
   Evaluator(const ExpressionEvaluatorData &data) : data(data) {}
 
@@ -46,7 +28,12 @@ struct Evaluator : EvaluatorInterface {
     return ::rangeText(range, data.parser.text);
   }
 
-  bool evaluateNumber(const StringRange &number_range)
+  Symbol rangeSymbol(const StringRange &range)
+  {
+    return Symbol(rangeText(range));
+  }
+
+  bool evaluateNumber(const StringRange &number_range) override
   {
     const string &text = rangeText(number_range);
 
@@ -71,7 +58,7 @@ struct Evaluator : EvaluatorInterface {
 
   bool evaluateVariable(const StringRange &identifer_range) override
   {
-    const string &identifier = rangeText(identifer_range);
+    Symbol identifier = rangeSymbol(identifer_range);
 
     Optional<Any> maybe_value =
       variableValue(identifier, data.environment_ptr);
@@ -87,336 +74,86 @@ struct Evaluator : EvaluatorInterface {
 
   bool evaluateMember(const StringRange &name_range) override
   {
-    const string &member_name = rangeText(name_range);
-    Evaluator &evaluator = *this;
-    ostream &error_stream = data.error_stream;
-    Any first_term = evaluator.pop();
-
-    if (Optional<Point2D> maybe_point2d = maybePoint2D(first_term)) {
-      if (member_name=="x") {
-        evaluator.push(Any(maybe_point2d->x));
-        return true;
-      }
-
-      if (member_name=="y") {
-        evaluator.push(Any(maybe_point2d->y));
-        return true;
-      }
-
-      return false;
-    }
+    Symbol member_name = rangeSymbol(name_range);
+    Any first_term = pop();
 
-    if (!first_term.isObject()) {
-      error_stream <<
-        "Attempt to get member of " << first_term.typeName() << "\n";
-      return false;
-    }
+    Optional<Any> maybe_result =
+      maybeMemberOf(first_term,member_name,data.error_stream);
 
-    Optional<Any> maybe_result = first_term.asObject().maybeMember(member_name);
-
-    if (!maybe_result) {
-      return false;
-    }
-
-    evaluator.push(std::move(*maybe_result));
-    return true;
+    return pushResult(std::move(maybe_result));
   }
 
   bool evaluateAddition() override
   {
-    Evaluator &evaluator = *this;
-    ostream &error_stream = data.error_stream;
-    Any second_term = evaluator.pop();
-    Any first_term = evaluator.pop();
-
-    if (first_term.isFloat() && second_term.isFloat()) {
-      evaluator.push( {first_term.asFloat() + second_term.asFloat()});
-      return true;
-    }
+    Any second_term = pop();
+    Any first_term = pop();
 
-    if (!first_term.isVector() || !second_term.isVector()) {
-      string first_term_type_name = first_term.typeName();
-      string second_term_type_name = second_term.typeName();
-      error_stream << "Invalid types for addition: " <<
-        first_term_type_name << " and " << second_term_type_name << ".\n";
-      return false;
-    }
-
-    const vector<Any> &first_vector = first_term.asVector();
-    const vector<Any> &second_vector = second_term.asVector();
-
-    if (first_vector.size() != second_vector.size()) {
-      error_stream << "Can't add vectors of different sizes.\n";
-      return false;
-    }
-
-    auto n = first_vector.size();
-    vector<Any> result;
-
-    for (decltype(n) i=0; i!=n; ++i) {
-      if (!first_vector[i].isFloat() || !second_vector[i].isFloat()) {
-        error_stream << "Can't add vectors containing non-numeric values.\n";
-        return false;
-      }
-
-      float first_value = first_vector[i].asFloat();
-      float second_value = second_vector[i].asFloat();
-
-      result.push_back(first_value + second_value);
-    }
-
-    evaluator.push( {std::move(result)} );
-    return true;
+    return
+      pushResult(maybeAdd(first_term,second_term,data.error_stream));
   }
 
   bool evaluateSubtraction() override
   {
-    Evaluator &evaluator = *this;
-    ostream &error_stream = data.error_stream;
-    Any second_term = evaluator.pop();
-    Any first_term = evaluator.pop();
-
-    if (first_term.isFloat() && second_term.isFloat()) {
-      evaluator.push(first_term.asFloat() - second_term.asFloat());
-      return true;
-    }
+    Any second_term = pop();
+    Any first_term = pop();
 
-    if (!first_term.isVector() || !second_term.isVector()) {
-      error_stream << "Invalid types for subtraction.\n";
-      return false;
-    }
-
-    const vector<Any> &first_vector = first_term.asVector();
-    const vector<Any> &second_vector = second_term.asVector();
-
-    if (first_vector.size() != second_vector.size()) {
-      error_stream << "Can't subtract vectors of different sizes.\n";
-      return false;
-    }
-
-    auto n = first_vector.size();
-    vector<Any> result;
-
-    for (decltype(n) i=0; i!=n; ++i) {
-      if (!first_vector[i].isFloat() || !second_vector[i].isFloat()) {
-        error_stream << "Can't subtract vectors containing non-numeric values.\n";
-        return false;
-      }
-
-      float first_value = first_vector[i].asFloat();
-      float second_value = second_vector[i].asFloat();
-
-      result.push_back(first_value - second_value);
-    }
-
-    evaluator.push(std::move(result));
-    return true;
+    return
+      pushResult(maybeSubtract(first_term,second_term,data.error_stream));
   }
 
   bool evaluateMultiplication() override
   {
-    Evaluator &evaluator = *this;
-    ostream &error_stream = data.error_stream;
-    Any second_term = evaluator.pop();
-    Any first_term = evaluator.pop();
-
-    if (first_term.isFloat() && second_term.isFloat()) {
-      float first_float = first_term.asFloat();
-      float second_float = second_term.asFloat();
-      evaluator.push( {first_float * second_float} );
-      return true;
-    }
-
-    if (first_term.isFloat() && second_term.isVector()) {
-      Optional<Any> maybe_result =
-        maybeScaleVector(
-          first_term.asFloat(),
-          second_term.asVector(),
-          error_stream
-        );
-
-      if (!maybe_result) {
-        return false;
-      }
-
-      evaluator.push(std::move(*maybe_result));
-      return true;
-    }
-
-    if (first_term.isVector() && second_term.isFloat()) {
-      Optional<Any> maybe_result =
-        maybeScaleVector(
-          second_term.asFloat(),
-          first_term.asVector(),
-          error_stream
-        );
-
-      if (!maybe_result) {
-        return false;
-      }
+    Any second_term = pop();
+    Any first_term = pop();
 
-      evaluator.push(std::move(*maybe_result));
-      return true;
-    }
-
-    error_stream << "Unhandled multiplication: " <<
-      first_term.typeName() << "*" <<
-      second_term.typeName() << "\n";
-
-    return false;
+    return
+      pushResult(maybeMultiply(first_term,second_term,data.error_stream));
   }
 
   bool evaluateDivision() override
   {
-    Evaluator &evaluator = *this;
-    ostream &error_stream = data.error_stream;
-    Any second_term = evaluator.pop();
-    Any first_term = evaluator.pop();
-
-    if (first_term.isVector() && second_term.isFloat()) {
-      const vector<Any> &first_vector = first_term.asVector();
-      float second_float = second_term.asFloat();
-      vector<Any> result;
-
-      for (auto &x : first_vector) {
-        if (!x.isFloat()) {
-          error_stream <<
-            "Can't divide a vector containing non-numeric values.\n";
-          return false;
-        }
-
-        result.push_back(x.asFloat() / second_float);
-      }
-
-      evaluator.push(std::move(result));
-      return true;
-    }
-    else if (first_term.isFloat() && second_term.isFloat()) {
-      evaluator.push( {first_term.asFloat() / second_term.asFloat()} );
-      return true;
-    }
-    else {
-      error_stream << "Unknown operation: " << first_term.typeName() << "/" <<
-        second_term.typeName() << "\n";
-    }
-
-    return false;
-  }
-
-  bool
-  evaluateObjectConstruction(
-    const Class &the_class, int n_arguments, int n_extra
-  )
-  {
-    Evaluator &evaluator = *this;
-    ostream &error_stream = data.error_stream;
-    vector<Any> arguments;
-    map<string,Any> named_arguments;
-    auto iter = evaluator.stack.end() - n_arguments*2;
-
-    for (int i=0; i!=n_arguments; ++i) {
-      string parameter_name = std::move(*iter++).asString();
-      named_arguments[parameter_name] = std::move(*iter++);
-    }
-
-    evaluator.stack.erase(evaluator.stack.end() - n_arguments*2 - n_extra, evaluator.stack.end());
+    Any second_term = pop();
+    Any first_term = pop();
 
-    assert(arguments.empty());
-    Optional<Object> maybe_object =
-      the_class.maybeMakeObject(named_arguments,error_stream);
-
-    if (!maybe_object) {
-      return false;
-    }
-
-    evaluator.push(Any(std::move(*maybe_object)));
-    return true;
-  }
-
-  bool
-  evaluateFunctionCall(
-    const Any &first_term, const int n_arguments, const int n_extra
-  )
-  {
-    Evaluator &evaluator = *this;
-    vector<Any> arguments;
-    map<string,Any> named_arguments;
-
-    {
-      auto iter = evaluator.stack.end() - n_arguments*2;
-
-      for (int i=0; i!=n_arguments; ++i) {
-        if (iter->isVoid()) {
-          ++iter;
-          arguments.push_back(std::move(*iter++));
-        }
-        else {
-          string parameter_name = std::move(*iter++).asString();
-          named_arguments[parameter_name] = std::move(*iter++);
-        }
-      }
-
-      evaluator.stack.erase(evaluator.stack.end() - n_arguments*2 - n_extra, evaluator.stack.end());
-    }
-
-    Optional<Any> maybe_result = first_term.asFunction()(arguments);
-
-    if (!maybe_result) {
-      return false;
-    }
-
-    evaluator.push(std::move(*maybe_result));
-    return true;
+    return
+      pushResult(maybeDivide(first_term,second_term,data.error_stream));
   }
 
   bool evaluateCall(const int n_arguments) override
   {
-    Evaluator &evaluator = *this;
-    ostream &error_stream = data.error_stream;
-    Any &first_term = *(evaluator.stack.end() - n_arguments*2 - 1);
-
-    if (first_term.isClassPtr()) {
-      const Class *class_ptr = first_term.asClassPtr();
-      assert(class_ptr);
-      const Class &the_class = *class_ptr;
-
-      return
-        evaluator.evaluateObjectConstruction(
-          the_class, n_arguments, /*n_extra*/1
-        );
-    }
-    else if (first_term.isFunction()) {
-      return
-        evaluator.evaluateFunctionCall(first_term, n_arguments, /*n_extra*/1);
-    }
-
-    // We had [term '('], but term wasn't a class or a function.
-    // What type did it have?
-    error_stream << "first_term.typeName():" << first_term.typeName() << "\n";
-    assert(false);
+    auto first_name = argument_names.end() - n_arguments;
+    ArgumentNames call_argument_names(first_name,argument_names.end());
+    argument_names.erase(first_name,argument_names.end());
+    return evaluateCallOnStack(stack,call_argument_names,data.error_stream);
   }
 
   bool evaluateVector(int n_elements) override
   {
-    vector<Any> v;
-
-    for (int i=0; i!=n_elements; ++i) {
-      v.push_back(std::move(*(stack.end()-n_elements+i)));
-    }
-
-    stack.erase(stack.end()-n_elements, stack.end());
-    push(Any(std::move(v)));
+    auto first = stack.end() - n_elements;
+    Any v = makeVectorValue(first,stack.end());
+    stack.erase(first,stack.end());
+    push(std::move(v));
     return true;
   }
 
   void evaluateNoName() override
   {
-    push(Any()); // name for unnamed argument
+    argument_names.emplace_back();
   }
 
   void evaluateName(const StringRange &range) override
   {
-    push(rangeText(range));
+    argument_names.push_back(rangeSymbol(range));
+  }
+
+  bool pushResult(Optional<Any> maybe_result)
+  {
+    if (!maybe_result) {
+      return false;
+    }
+
+    push(std::move(*maybe_result));
+    return true;
   }
 
   void push(Any arg)
@@ -458,7 +195,6 @@ Optional<Any>
   )
 {
   Evaluator evaluator(data);
-  const string &identifier = rangeText(identifier_range, data.parser.text);
 
   bool could_parse =
     ExpressionParser(
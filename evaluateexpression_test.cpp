@@ -13,6 +13,9 @@
 #include "anyio.hpp"
 #include "objectdatawithfmethod.hpp"
 #include "stringutil.hpp"
+#include "contains.hpp"
+#include "compilestatement.hpp"
+#include "expressionvm.hpp"
 
 using std::vector;
 using std::cerr;
@@ -27,7 +30,7 @@ using std::ostream;
 static Class stubClass()
 {
   auto make_object_function =
-    [&](const Class::NamedParameters &,ostream &/*error_stream*/)
+    [&](const Arguments &,ostream &/*error_stream*/)
       -> Optional<Object>
     {
       assert(false);
@@ -48,6 +51,44 @@ struct Tester {
 }
 
 
+// Evaluate using the reference evaluator, and verify that evaluating the
+// compiled bytecode gives the same result and the same error messages.
+static Optional<Any>
+  evaluateAndCompare(const ExpressionEvaluatorData &data,Tester &tester)
+{
+  string::size_type error_start = tester.errorOutput().size();
+  Optional<Any> maybe_result = evaluateExpression(data);
+  string reference_error = tester.errorOutput().substr(error_start);
+
+  ostringstream vm_error_stream;
+  vector<Any> stack;
+  vector<const Object::Method *> method_stack;
+
+  Optional<Any> maybe_vm_result =
+    evaluateCompiledExpression(
+      compileExpression(data.parser.text),
+      {
+        data.input_values,
+        vm_error_stream,
+        data.environment_ptr,
+        stack,
+        method_stack
+      }
+    );
+
+  assert(bool(maybe_vm_result)==bool(maybe_result));
+
+  if (maybe_result) {
+    assert(*maybe_vm_result==*maybe_result);
+  }
+
+  assert(vm_error_stream.str()==reference_error);
+  assert(stack.empty());
+  assert(method_stack.empty());
+  return maybe_result;
+}
+
+
 static Optional<Any>
   evaluateStringWithTester(const string &arg,Tester &tester)
 {
@@ -66,7 +107,7 @@ static Optional<Any>
   string error_string = tester.error_stream.str();
   assert(error_string=="");
 
-  return evaluateExpression(data);
+  return evaluateAndCompare(data,tester);
 }
 
 
@@ -85,7 +126,7 @@ static string evaluateStringWithError(const string &arg)
     &tester.environment
   };
 
-  Optional<Any> maybe_result = evaluateExpression(data);
+  Optional<Any> maybe_result = evaluateAndCompare(data,tester);
   assert(!maybe_result);
   return tester.error_stream.str();
 }
@@ -146,7 +187,7 @@ static void testAddingInputs()
     &tester.environment
   };
 
-  Optional<Any> maybe_result = evaluateExpression(data);
+  Optional<Any> maybe_result = evaluateAndCompare(data,tester);
   assert(maybe_result);
   const Any& result = *maybe_result;
   assert(result.isFloat());
@@ -171,7 +212,7 @@ static void testSubtractingInputs()
     &tester.environment
   };
 
-  Optional<Any> maybe_result = evaluateExpression(data);
+  Optional<Any> maybe_result = evaluateAndCompare(data,tester);
   assert(maybe_result);
   const Any& result = *maybe_result;
   assert(result==makeVector(48,10));
@@ -194,7 +235,7 @@ static void testIdentifier()
     &tester.environment
   };
 
-  Optional<Any> maybe_result = evaluateExpression(data);
+  Optional<Any> maybe_result = evaluateAndCompare(data,tester);
 
   if (!maybe_result) {
     string error_text = tester.error_stream.str();
@@ -304,7 +345,7 @@ static void testCallingMemberFunctionWithNoArguments()
 {
   string expression = "obj.f()";
 
-  auto f = [](const vector<Any> &) -> Optional<Any> { return {5}; };
+  auto f = [](const Arguments &) -> Optional<Any> { return {5}; };
 
   unique_ptr<ObjectDataWithFMethod> object_data_ptr =
     make_unique<ObjectDataWithFMethod>(f);
@@ -326,7 +367,7 @@ static void testCallingMemberFunctionWithArgument()
   Tester tester;
 
   auto f =
-    [](const vector<Any> &arg) -> Optional<Any> {
+    [](const Arguments &arg) -> Optional<Any> {
       assert(arg.size()==1);
       return arg[0];
     };
@@ -350,7 +391,7 @@ static void testCallingFunctionWithTwoArguments()
   string expression = "f(1,2)";
 
   auto f =
-    [](const vector<Any> &args) -> Optional<Any> {
+    [](const Arguments &args) -> Optional<Any> {
       assert(args.size() == 2);
       assert(args[0].asFloat() == 1);
       assert(args[1].asFloat() == 2);
@@ -369,7 +410,7 @@ static void testCallingFunctionWithVariableParameter()
   string expression = "f(a)";
 
   auto f =
-    [](const vector<Any> &args) -> Optional<Any> {
+    [](const Arguments &args) -> Optional<Any> {
       assert(args.size() == 1);
       assert(args[0].asFloat() == 5);
       return Any(6);
@@ -383,6 +424,38 @@ static void testCallingFunctionWithVariableParameter()
 }
 
 
+static void testCallingFunctionWithNamedArgument()
+{
+  // Named arguments are ignored for functions.
+  string expression = "f(a=1,2,b=3,4)";
+
+  auto f =
+    [](const Arguments &args) -> Optional<Any> {
+      assert(args.size() == 2);
+      assert(args[0].asFloat() == 2);
+      assert(args[1].asFloat() == 4);
+      return Any(5);
+    };
+
+  Tester tester;
+  tester.environment["f"] = Function{f};
+  Optional<Any> result = evaluateStringWithTester(expression, tester);
+  assert(result->asFloat() == 5);
+}
+
+
+static void testPosExprWithPositionalArgument()
+{
+  Class pos_expr_class = posExprClass();
+  Tester tester;
+  tester.environment["PosExpr"] = &pos_expr_class;
+  Optional<Any> maybe_result =
+    evaluateStringWithTester("PosExpr(5)",tester);
+  assert(!maybe_result);
+  assert(tester.error_stream.str()=="Class arguments must be named.\n");
+}
+
+
 static void testBodyPositionWithLocal()
 {
   Tester tester;
@@ -396,6 +469,58 @@ static void testBodyPositionWithLocal()
 }
 
 
+static void testBodyGlobalVec()
+{
+  Tester tester;
+  Scene scene;
+  Scene::Body &body = scene.addBody("body");
+  tester.environment["body"] = makeBodyObject(BodyLink(&scene,&body));
+  Optional<Any> maybe_result =
+    evaluateStringWithTester("body.globalVec([1,2])",tester);
+  assert(maybe_result->isFloatVector());
+  assert(*maybe_result==makeVector(1,2));
+}
+
+
+static void testBodyMethodsAreMembers()
+{
+  Scene scene;
+  Scene::Body &body = scene.addBody("body");
+  Object body_object = makeBodyObject(BodyLink(&scene,&body));
+  const Object::Data &data = body_object.data();
+  vector<string> member_names = data.memberNames();
+  assert(!data.methods().empty());
+
+  for (const Object::Method &method : data.methods()) {
+    assert(body_object.maybeMethod(method.name)==&method);
+    assert(contains(member_names,method.name.str()));
+    assert(body_object.maybeMember(method.name)->isFunction());
+  }
+
+  assert(!body_object.maybeMethod(Symbol("x")));
+}
+
+
+static void testSceneMembers()
+{
+  Tester tester;
+  Scene scene;
+  Scene::Body &body = scene.addBody("body1");
+  tester.environment["scene"] = makeSceneObject(scene);
+
+  Optional<Any> maybe_result =
+    evaluateStringWithTester("scene.body1.pos()",tester);
+
+  assert(maybePoint2D(*maybe_result));
+
+  scene.setBodyName(body,"body2");
+  assert(evaluateStringWithTester("scene.body2.pos()",tester));
+
+  assert(!evaluateStringWithTester("scene.body1",tester));
+  assert(tester.errorOutput()=="Scene has no member 'body1'\n");
+}
+
+
 static void testObjectConstructionWithMissingComma()
 {
   Class test_class = stubClass();
@@ -411,6 +536,15 @@ static void testObjectConstructionWithMissingComma()
 }
 
 
+static void testPackedVectors()
+{
+  assert(evaluateString("[1,2]")->isFloatVector());
+  assert(evaluateString("[1,2]+[3,4]")->isFloatVector());
+  assert(evaluateString("[[],2]")->isVector());
+  assert(evaluateString("[]")->isVector());
+}
+
+
 static void testPoint2DMembers()
 {
   Point2D point(1.5,2.5);
@@ -469,6 +603,7 @@ int main()
   testPosExprWithNoParameters();
   testPosExprWithBadBody();
   testPosExprWithUnknownParameter();
+  testPackedVectors();
   testPoint2DMembers();
   testCallingUnknownFunction();
   testCallingFunctionWithMissingCloseParen();
@@ -476,6 +611,11 @@ int main()
   testCallingMemberFunctionWithArgument();
   testCallingFunctionWithTwoArguments();
   testCallingFunctionWithVariableParameter();
+  testCallingFunctionWithNamedArgument();
+  testPosExprWithPositionalArgument();
   testBodyPositionWithLocal();
+  testBodyGlobalVec();
+  testBodyMethodsAreMembers();
+  testSceneMembers();
   testObjectConstructionWithMissingComma();
 }
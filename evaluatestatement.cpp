@@ -1,9 +1,7 @@
 #include "evaluatestatement.hpp"
 
-#include "stringparser.hpp"
-#include "evaluateexpression.hpp"
-#include "anyio.hpp"
-#include "rangetext.hpp"
+#include "expressionvm.hpp"
+#include "compilestatement.hpp"
 
 using std::string;
 using std::vector;
@@ -13,102 +11,112 @@ using std::cerr;
 
 Optional<Any>
   evaluateStatement(
-    const string &statement,
+    const CompiledStatement &statement,
     const vector<Any> &input_values,
     Executor &executor,
     ostream &error_stream,
-    const AllocateEnvironmentFunction &allocate_environment_function
+    const AllocateEnvironmentFunction &allocate_environment_function,
+    vector<Any> &evaluation_stack,
+    vector<const Object::Method *> &method_stack
   )
 {
-  int character_index = 0;
-  StringParser parser{statement,character_index};
-  parser.skipWhitespace();
-  int input_index = 0;
+  using Type = CompiledStatement::Type;
 
-  ExpressionEvaluatorData data{
-    parser,
+  CompiledExpressionEvaluatorData data{
     input_values,
-    input_index,
     error_stream,
-    executor.parent_environment_ptr
+    executor.parent_environment_ptr,
+    evaluation_stack,
+    method_stack
   };
 
-  Optional<StringParser::Range> maybe_identifier_range =
-    parser.maybeIdentifierRange();
-
-  if (maybe_identifier_range) {
-    string identifier = rangeText(*maybe_identifier_range, parser.text);
-
-    if (identifier=="show") {
-      if (parser.peekChar()!='(') {
-        error_stream << "Missing '(' after show\n";
-        return {};
-      }
-
-      parser.skipChar();
-
-      Optional<Any> maybe_value = evaluateExpression(data);
-
-      if (!maybe_value) {
-        return {};
-      }
+  switch (statement.type) {
+    case Type::error:
+      error_stream << statement.error_message;
+      return {};
+    case Type::show:
+      {
+        Optional<Any> maybe_value =
+          evaluateCompiledExpression(statement.expression,data);
 
-      if (parser.peekChar()!=')') {
-        error_stream << "Missing ')' for show\n";
-        return {};
-      }
+        if (!maybe_value) {
+          return {};
+        }
 
-      parser.skipChar();
+        executor.executeShow(*maybe_value);
 
-      executor.executeShow(*maybe_value);
+        if (statement.has_trailing_text) {
+          return {};
+        }
 
-      if (!parser.atEnd()) {
-        return {};
+        return Any();
       }
+    case Type::return_value:
+      {
+        Optional<Any> maybe_value =
+          evaluateCompiledExpression(statement.expression,data);
 
-      return Any();
-    }
-
-    if (identifier=="return") {
-      Optional<Any> maybe_value = evaluateExpression(data);
+        if (!maybe_value) {
+          return {};
+        }
 
-      if (!maybe_value) {
-        return {};
-      }
+        if (!executor.tryExecuteReturn(*maybe_value,error_stream)) {
+          return Any();
+        }
 
-      if (!executor.tryExecuteReturn(*maybe_value,error_stream)) {
         return Any();
       }
+    case Type::assignment:
+      {
+        Optional<Any> maybe_result =
+          evaluateCompiledExpression(statement.expression,data);
+
+        if (maybe_result) {
+          Environment &env =
+            allocate_environment_function(executor.parent_environment_ptr);
+
+          env[statement.variable_name] = *maybe_result;
+
+          // We have to make the newly allocated environment be the current
+          // environment here.
+          executor.parent_environment_ptr = &env;
+        }
+        else {
+          // We got an error evaluating the expression, so we can't do
+          // the assignment.
+        }
 
-      return Any();
-    }
-
-    if (parser.peekChar() == '=') {
-      const string &variable_name = identifier;
-      parser.skipChar();
-      Optional<Any> maybe_result = evaluateExpression(data);
-
-      if (maybe_result) {
-        Environment &env =
-          allocate_environment_function(executor.parent_environment_ptr);
-
-        env[variable_name] = *maybe_result;
-
-        // We have to make the newly allocated environment be the current
-        // environment here.
-        executor.parent_environment_ptr = &env;
-      }
-      else {
-        // We got an error evaluating the expression, so we can't do
-        // the assignment.
+        return Any();
       }
+    case Type::expression:
+      return evaluateCompiledExpression(statement.expression,data);
+  }
 
-      return Any();
-    }
+  assert(false);
+  return {};
+}
 
-    return
-      evaluateExpressionStartingWithIdentifier(data, *maybe_identifier_range);
-  }
 
-  return evaluateExpression(data);
+Optional<Any>
+  evaluateStatement(
+    const string &statement,
+    const vector<Any> &input_values,
+    Executor &executor,
+    ostream &error_stream,
+    const AllocateEnvironmentFunction &allocate_environment_function
+  )
+{
+  vector<Any> evaluation_stack;
+  vector<const Object::Method *> method_stack;
+
+  return
+    evaluateStatement(
+      compileStatement(statement),
+      input_values,
+      executor,
+      error_stream,
+      allocate_environment_function,
+      evaluation_stack,
+      method_stack
+    );
 }
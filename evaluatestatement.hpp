@@ -2,10 +2,22 @@
 #include "optional.hpp"
 #include "any.hpp"
 #include "executor.hpp"
+#include "compiledstatement.hpp"
 
 using AllocateEnvironmentFunction =
   std::function<Environment &(const Environment *parent_environment_ptr)>;
 
+extern Optional<Any>
+  evaluateStatement(
+    const CompiledStatement &statement,
+    const std::vector<Any> &input_values,
+    Executor &executor,
+    std::ostream &error_stream,
+    const AllocateEnvironmentFunction &,
+    std::vector<Any> &evaluation_stack,
+    std::vector<const Object::Method *> &method_stack
+  );
+
 extern Optional<Any>
   evaluateStatement(
     const std::string &statement,
@@ -1,6 +1,7 @@
 #include "evaluatestatement.hpp"
 
 #include <sstream>
+#include "compilestatement.hpp"
 #include "objectdatawithfmethod.hpp"
 #include "fakeexecutor.hpp"
 #include "scene.hpp"
@@ -58,6 +59,28 @@ struct Tester {
     return maybe_result;
   }
 
+  Optional<Any>
+    evaluate(
+      const CompiledStatement &statement,
+      vector<Any> &evaluation_stack,
+      vector<const Object::Method *> &method_stack
+    )
+  {
+    auto allocate_environment_function =
+      [](const Environment *) -> Environment& { assert(false); };
+
+    return
+      evaluateStatement(
+        statement,
+        input_values,
+        executor,
+        error_stream,
+        allocate_environment_function,
+        evaluation_stack,
+        method_stack
+      );
+  }
+
   string errorString()
   {
     return error_stream.str();
@@ -148,7 +171,7 @@ static void testCallingMethod()
 {
   string line_text = "$.f()";
 
-  auto f = [](const vector<Any> &) -> Optional<Any> { return {3}; };
+  auto f = [](const Arguments &) -> Optional<Any> { return {3}; };
   Tester tester;
   tester.input_values.push_back(makeObjectWithFMethod(f));
   Any result = testLineTextWithoutError(line_text,tester);
@@ -168,6 +191,29 @@ static void testCallingSceneBodyPos()
 }
 
 
+static void testReusingTheStacks()
+{
+  // Evaluating the statement again can use the space that the first
+  // evaluation left in the stacks, so it doesn't allocate them again.
+  CompiledStatement statement = compileStatement("scene.body1.pos()");
+  Scene scene;
+  scene.addBody("body1");
+  Tester tester;
+  tester.environment["scene"] = makeSceneObject(scene);
+  vector<Any> evaluation_stack;
+  vector<const Object::Method *> method_stack;
+  assert(tester.evaluate(statement,evaluation_stack,method_stack));
+  assert(evaluation_stack.empty());
+  assert(method_stack.empty());
+  assert(method_stack.capacity()!=0);
+  const Any *evaluation_stack_data = evaluation_stack.data();
+  const Object::Method *const *method_stack_data = method_stack.data();
+  assert(tester.evaluate(statement,evaluation_stack,method_stack));
+  assert(evaluation_stack.data()==evaluation_stack_data);
+  assert(method_stack.data()==method_stack_data);
+}
+
+
 static void testCase1()
 {
   Tester tester;
@@ -204,6 +250,7 @@ int main()
 
   testCallingMethod();
   testCallingSceneBodyPos();
+  testReusingTheStacks();
 
   testCase1();
 }
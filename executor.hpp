@@ -23,7 +23,7 @@ struct Executor {
   {
   }
 
-  Optional<Any> variableValue(const std::string &name) const
+  Optional<Any> variableValue(const Symbol &name) const
   {
     return ::variableValue(name,parent_environment_ptr);
   }
@@ -50,6 +50,12 @@ struct ExpectedPolicy {
 
   ExpectedPolicy(NoInitTag) { }
 
+  static bool
+    differentTypesAreEqual(const ExpectedPolicy &,const ExpectedPolicy &)
+  {
+    return false;
+  }
+
   bool isValue() const { return _type==Type::value; }
   bool isError() const { return _type==Type::error; }
 
@@ -0,0 +1,201 @@
+#include "expressionvm.hpp"
+
+#include "anyoperations.hpp"
+
+using std::vector;
+using std::string;
+using std::ostream;
+using Opcode = CompiledExpression::Opcode;
+using Instruction = CompiledExpression::Instruction;
+
+
+namespace {
+struct VM {
+  const CompiledExpression &expression;
+  const CompiledExpressionEvaluatorData &data;
+  vector<Any> &stack;
+  vector<const Object::Method *> &method_stack;
+
+  VM(
+    const CompiledExpression &expression_arg,
+    const CompiledExpressionEvaluatorData &data_arg
+  )
+  : expression(expression_arg),
+    data(data_arg),
+    stack(data_arg.stack),
+    method_stack(data_arg.method_stack)
+  {
+  }
+
+  using BinaryOperation =
+    Optional<Any> (const Any &,const Any &,ostream &error_stream);
+
+  bool binary(BinaryOperation &operation)
+  {
+    auto n = stack.size();
+    assert(n>=2);
+    Optional<Any> maybe_result =
+      operation(stack[n-2],stack[n-1],data.error_stream);
+    stack.pop_back();
+
+    if (!maybe_result) {
+      return false;
+    }
+
+    stack.back() = std::move(*maybe_result);
+    return true;
+  }
+
+  bool loadVariable(const CompiledExpression::Variable &variable)
+  {
+    const Any *value_ptr =
+      variable.lookup_cache.maybeLookup(variable.name,data.environment_ptr);
+
+    if (!value_ptr) {
+      data.error_stream << "Unknown name: " << variable.name << "\n";
+      return false;
+    }
+
+    stack.push_back(Any(*value_ptr));
+    return true;
+  }
+
+  void makeVector(int n_elements)
+  {
+    auto first = stack.end() - n_elements;
+    Any v = makeVectorValue(first,stack.end());
+    stack.erase(first,stack.end());
+    stack.push_back(std::move(v));
+  }
+
+  bool member(const Symbol &member_name)
+  {
+    Optional<Any> maybe_result =
+      maybeMemberOf(stack.back(),member_name,data.error_stream);
+
+    if (!maybe_result) {
+      stack.pop_back();
+      return false;
+    }
+
+    stack.back() = std::move(*maybe_result);
+    return true;
+  }
+
+  bool memberMethod(const Symbol &member_name)
+  {
+    const Any &object = stack.back();
+
+    if (object.isObject()) {
+      if (const Object::Method *method_ptr =
+          object.asObject().maybeMethod(member_name)) {
+        method_stack.push_back(method_ptr);
+        return true;
+      }
+    }
+
+    method_stack.push_back(nullptr);
+    return member(member_name);
+  }
+
+  bool methodCall(const ArgumentNames &argument_names)
+  {
+    assert(!method_stack.empty());
+    const Object::Method *method_ptr = method_stack.back();
+    method_stack.pop_back();
+
+    if (!method_ptr) {
+      return evaluateCallOnStack(stack,argument_names,data.error_stream);
+    }
+
+    return evaluateMethodCallOnStack(stack,*method_ptr,argument_names);
+  }
+
+  bool step(const Instruction &instruction)
+  {
+    int operand = instruction.operand;
+
+    switch (instruction.opcode) {
+      case Opcode::push_number:
+        stack.push_back(Any(expression.numbers[operand]));
+        return true;
+      case Opcode::push_constant:
+        stack.push_back(Any(expression.constants[operand]));
+        return true;
+      case Opcode::push_input:
+        stack.push_back(Any(data.input_values[operand]));
+        return true;
+      case Opcode::load_variable:
+        return loadVariable(expression.variables[operand]);
+      case Opcode::make_vector:
+        makeVector(operand);
+        return true;
+      case Opcode::add:
+        return binary(maybeAdd);
+      case Opcode::subtract:
+        return binary(maybeSubtract);
+      case Opcode::multiply:
+        return binary(maybeMultiply);
+      case Opcode::divide:
+        return binary(maybeDivide);
+      case Opcode::member:
+        return member(expression.symbols[operand]);
+      case Opcode::call:
+        return
+          evaluateCallOnStack(
+            stack,expression.calls[operand],data.error_stream
+          );
+      case Opcode::member_method:
+        return memberMethod(expression.symbols[operand]);
+      case Opcode::method_call:
+        return methodCall(expression.calls[operand]);
+      case Opcode::fail:
+        data.error_stream << expression.strings[operand];
+        return false;
+      case Opcode::return_value:
+        assert(false); // handled by run()
+        return false;
+    }
+
+    assert(false);
+    return false;
+  }
+
+  Optional<Any> run()
+  {
+    for (const Instruction &instruction : expression.instructions) {
+      if (instruction.opcode==Opcode::return_value) {
+        Any result = std::move(stack.back());
+        stack.pop_back();
+        return {std::move(result)};
+      }
+
+      if (!step(instruction)) {
+        return {};
+      }
+    }
+
+    assert(false);
+    return {};
+  }
+};
+}
+
+
+Optional<Any>
+  evaluateCompiledExpression(
+    const CompiledExpression &expression,
+    const CompiledExpressionEvaluatorData &data
+  )
+{
+  vector<Any> &stack = data.stack;
+  vector<const Object::Method *> &method_stack = data.method_stack;
+  auto stack_base = stack.size();
+  auto method_stack_base = method_stack.size();
+  Optional<Any> maybe_result = VM(expression,data).run();
+  stack.erase(stack.begin() + stack_base,stack.end());
+  method_stack.erase(
+    method_stack.begin() + method_stack_base,method_stack.end()
+  );
+  return maybe_result;
+}
@@ -0,0 +1,31 @@
+#ifndef EXPRESSIONVM_HPP_
+#define EXPRESSIONVM_HPP_
+
+#include "optional.hpp"
+#include "any.hpp"
+#include "environment.hpp"
+#include "compiledstatement.hpp"
+
+
+struct CompiledExpressionEvaluatorData {
+  const std::vector<Any> &input_values;
+  std::ostream &error_stream;
+  const Environment *environment_ptr;
+  std::vector<Any> &stack;
+    // This is only used as scratch space, so it can be reused between
+    // evaluations to avoid reallocating it.
+  std::vector<const Object::Method *> &method_stack;
+    // The method found by each member_method whose method_call hasn't
+    // been reached yet, or null if the member was gotten the usual way.
+    // This is scratch space like the stack.
+};
+
+
+extern Optional<Any>
+  evaluateCompiledExpression(
+    const CompiledExpression &,
+    const CompiledExpressionEvaluatorData &
+  );
+
+
+#endif /* EXPRESSIONVM_HPP_ */
@@ -213,17 +213,20 @@ struct FakeDiagramEditor : DiagramEditor {
 
   ViewportPoint nodeCenter(NodeIndex node_index)
   {
-    return nodeRenderInfo(diagram().node(node_index)).body_outer_rect.center();
+    const Node &node = constDiagram().node(node_index);
+    return nodeRenderInfo(node).body_outer_rect.center();
   }
 
   ViewportPoint nodeInputPosition(NodeIndex node_index,int output_index)
   {
-    return nodeInputCircle(node(node_index),output_index).center;
+    const Node &node = constDiagram().node(node_index);
+    return nodeInputCircle(node,output_index).center;
   }
 
   ViewportPoint nodeOutputPosition(NodeIndex node_index,int output_index)
   {
-    return nodeOutputCircle(node(node_index),output_index).center;
+    const Node &node = constDiagram().node(node_index);
+    return nodeOutputCircle(node,output_index).center;
   }
 
   void callDiagramChangedCallback()
@@ -0,0 +1,224 @@
+#include "floatkernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FLOATKERNELS_X86 1
+#include <immintrin.h>
+#else
+#define FLOATKERNELS_X86 0
+#endif
+
+using std::vector;
+
+
+static void scalarAdd(const float *a,const float *b,float *result,int n)
+{
+  for (int i=0; i!=n; ++i) {
+    result[i] = a[i] + b[i];
+  }
+}
+
+
+static void scalarSubtract(const float *a,const float *b,float *result,int n)
+{
+  for (int i=0; i!=n; ++i) {
+    result[i] = a[i] - b[i];
+  }
+}
+
+
+static void scalarScale(const float *a,float b,float *result,int n)
+{
+  for (int i=0; i!=n; ++i) {
+    result[i] = b*a[i];
+  }
+}
+
+
+static void scalarDivide(const float *a,float b,float *result,int n)
+{
+  for (int i=0; i!=n; ++i) {
+    result[i] = a[i] / b;
+  }
+}
+
+
+const FloatKernels &scalarFloatKernels()
+{
+  static const FloatKernels kernels = {
+    "scalar", scalarAdd, scalarSubtract, scalarScale, scalarDivide
+  };
+
+  return kernels;
+}
+
+
+#if FLOATKERNELS_X86
+// These process as many elements as they can using vector registers and
+// leave the rest to the scalar versions.  Division is done with a divide
+// instruction instead of multiplying by the reciprocal so that the results
+// match exactly.
+
+__attribute__((target("sse2")))
+static void sseAdd(const float *a,const float *b,float *result,int n)
+{
+  int i = 0;
+
+  for (; i+4<=n; i+=4) {
+    _mm_storeu_ps(
+      result+i,_mm_add_ps(_mm_loadu_ps(a+i),_mm_loadu_ps(b+i))
+    );
+  }
+
+  scalarAdd(a+i,b+i,result+i,n-i);
+}
+
+
+__attribute__((target("sse2")))
+static void sseSubtract(const float *a,const float *b,float *result,int n)
+{
+  int i = 0;
+
+  for (; i+4<=n; i+=4) {
+    _mm_storeu_ps(
+      result+i,_mm_sub_ps(_mm_loadu_ps(a+i),_mm_loadu_ps(b+i))
+    );
+  }
+
+  scalarSubtract(a+i,b+i,result+i,n-i);
+}
+
+
+__attribute__((target("sse2")))
+static void sseScale(const float *a,float b,float *result,int n)
+{
+  __m128 bv = _mm_set1_ps(b);
+  int i = 0;
+
+  for (; i+4<=n; i+=4) {
+    _mm_storeu_ps(result+i,_mm_mul_ps(bv,_mm_loadu_ps(a+i)));
+  }
+
+  scalarScale(a+i,b,result+i,n-i);
+}
+
+
+__attribute__((target("sse2")))
+static void sseDivide(const float *a,float b,float *result,int n)
+{
+  __m128 bv = _mm_set1_ps(b);
+  int i = 0;
+
+  for (; i+4<=n; i+=4) {
+    _mm_storeu_ps(result+i,_mm_div_ps(_mm_loadu_ps(a+i),bv));
+  }
+
+  scalarDivide(a+i,b,result+i,n-i);
+}
+
+
+__attribute__((target("avx")))
+static void avxAdd(const float *a,const float *b,float *result,int n)
+{
+  int i = 0;
+
+  for (; i+8<=n; i+=8) {
+    _mm256_storeu_ps(
+      result+i,_mm256_add_ps(_mm256_loadu_ps(a+i),_mm256_loadu_ps(b+i))
+    );
+  }
+
+  sseAdd(a+i,b+i,result+i,n-i);
+}
+
+
+__attribute__((target("avx")))
+static void avxSubtract(const float *a,const float *b,float *result,int n)
+{
+  int i = 0;
+
+  for (; i+8<=n; i+=8) {
+    _mm256_storeu_ps(
+      result+i,_mm256_sub_ps(_mm256_loadu_ps(a+i),_mm256_loadu_ps(b+i))
+    );
+  }
+
+  sseSubtract(a+i,b+i,result+i,n-i);
+}
+
+
+__attribute__((target("avx")))
+static void avxScale(const float *a,float b,float *result,int n)
+{
+  __m256 bv = _mm256_set1_ps(b);
+  int i = 0;
+
+  for (; i+8<=n; i+=8) {
+    _mm256_storeu_ps(result+i,_mm256_mul_ps(bv,_mm256_loadu_ps(a+i)));
+  }
+
+  sseScale(a+i,b,result+i,n-i);
+}
+
+
+__attribute__((target("avx")))
+static void avxDivide(const float *a,float b,float *result,int n)
+{
+  __m256 bv = _mm256_set1_ps(b);
+  int i = 0;
+
+  for (; i+8<=n; i+=8) {
+    _mm256_storeu_ps(result+i,_mm256_div_ps(_mm256_loadu_ps(a+i),bv));
+  }
+
+  sseDivide(a+i,b,result+i,n-i);
+}
+
+
+static const FloatKernels &sseFloatKernels()
+{
+  static const FloatKernels kernels = {
+    "sse", sseAdd, sseSubtract, sseScale, sseDivide
+  };
+
+  return kernels;
+}
+
+
+static const FloatKernels &avxFloatKernels()
+{
+  static const FloatKernels kernels = {
+    "avx", avxAdd, avxSubtract, avxScale, avxDivide
+  };
+
+  return kernels;
+}
+#endif
+
+
+vector<const FloatKernels *> availableFloatKernels()
+{
+  vector<const FloatKernels *> result;
+  result.push_back(&scalarFloatKernels());
+
+#if FLOATKERNELS_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("sse2")) {
+    result.push_back(&sseFloatKernels());
+  }
+
+  if (__builtin_cpu_supports("avx")) {
+    result.push_back(&avxFloatKernels());
+  }
+#endif
+
+  return result;
+}
+
+
+const FloatKernels &floatKernels()
+{
+  // The available kernels are listed from worst to best.
+  static const FloatKernels &kernels = *availableFloatKernels().back();
+  return kernels;
+}
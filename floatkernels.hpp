@@ -0,0 +1,30 @@
+#ifndef FLOATKERNELS_HPP_
+#define FLOATKERNELS_HPP_
+
+#include <vector>
+
+
+// Element-wise operations on arrays of floats.  There are several
+// implementations, and the best one for the CPU we're running on is
+// chosen the first time floatKernels() is called.  The results are the
+// same for all implementations.
+struct FloatKernels {
+  using BinaryFunction =
+    void (const float *a,const float *b,float *result,int n);
+  using ScalarFunction =
+    void (const float *a,float b,float *result,int n);
+
+  const char *name;
+  BinaryFunction *add;
+  BinaryFunction *subtract;
+  ScalarFunction *scale;
+  ScalarFunction *divide;
+};
+
+
+extern const FloatKernels &floatKernels();
+extern const FloatKernels &scalarFloatKernels();
+extern std::vector<const FloatKernels *> availableFloatKernels();
+
+
+#endif /* FLOATKERNELS_HPP_ */
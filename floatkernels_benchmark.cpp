@@ -0,0 +1,123 @@
+#include "floatkernels.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <functional>
+#include "any.hpp"
+#include "anyoperations.hpp"
+
+using std::vector;
+using std::cout;
+using std::string;
+using Clock = std::chrono::steady_clock;
+
+
+// This compares adding and scaling vectors using the general vector<Any>
+// representation, packed vectors, and the kernels directly.  Run it
+// with different sizes to see where the packed vectors pay off.
+
+
+static double nanosecondsPerElement(int n,const std::function<void()> &f)
+{
+  // Repeat enough times that the total work is about the same for
+  // each size.
+  int n_repetitions = std::max(1,(1<<24)/std::max(n,1));
+  Clock::time_point start_time = Clock::now();
+
+  for (int i=0; i!=n_repetitions; ++i) {
+    f();
+  }
+
+  std::chrono::duration<double,std::nano> duration = Clock::now() - start_time;
+  return duration.count()/n_repetitions/std::max(n,1);
+}
+
+
+static Any makeAnyVector(int n)
+{
+  vector<Any> result;
+
+  for (int i=0; i!=n; ++i) {
+    result.push_back(float(i));
+  }
+
+  return Any(std::move(result));
+}
+
+
+static Any makePackedVector(int n)
+{
+  FloatVector result(n);
+
+  for (int i=0; i!=n; ++i) {
+    result[i] = i;
+  }
+
+  return Any(std::move(result));
+}
+
+
+static void benchmarkSize(int n)
+{
+  std::ostringstream error_stream;
+  Any any_a = makeAnyVector(n), any_b = makeAnyVector(n);
+  Any packed_a = makePackedVector(n), packed_b = makePackedVector(n);
+  FloatVector result(n);
+  const float *a = packed_a.asFloatVector().begin();
+  const float *b = packed_b.asFloatVector().begin();
+  const FloatKernels &scalar = scalarFloatKernels();
+  const FloatKernels &best = floatKernels();
+  volatile float sink = 0;
+
+  auto report = [&](const string &name,const std::function<void()> &f){
+    cout << "  " << name << ": " << nanosecondsPerElement(n,f) << " ns\n";
+  };
+
+  cout << "n=" << n << " (ns per element)\n";
+
+  report("add vector<Any>",[&]{ sink = !!maybeAdd(any_a,any_b,error_stream); });
+  report("add packed",[&]{ sink = !!maybeAdd(packed_a,packed_b,error_stream); });
+  report("add scalar kernel",[&]{
+    scalar.add(a,b,result.begin(),n);
+    sink = result[0];
+  });
+  report(string("add ") + best.name + " kernel",[&]{
+    best.add(a,b,result.begin(),n);
+    sink = result[0];
+  });
+
+  Any two(2);
+  report("scale vector<Any>",[&]{
+    sink = !!maybeMultiply(two,any_a,error_stream);
+  });
+  report("scale packed",[&]{
+    sink = !!maybeMultiply(two,packed_a,error_stream);
+  });
+  report("scale scalar kernel",[&]{
+    scalar.scale(a,2,result.begin(),n);
+    sink = result[0];
+  });
+  report(string("scale ") + best.name + " kernel",[&]{
+    best.scale(a,2,result.begin(),n);
+    sink = result[0];
+  });
+}
+
+
+int main(int argc,char **argv)
+{
+  vector<int> sizes;
+
+  for (int i=1; i<argc; ++i) {
+    sizes.push_back(std::stoi(argv[i]));
+  }
+
+  if (sizes.empty()) {
+    sizes = {2,4,64,4096,1<<20};
+  }
+
+  for (int n : sizes) {
+    benchmarkSize(n);
+  }
+}
@@ -0,0 +1,71 @@
+#include "floatkernels.hpp"
+
+#include <cassert>
+#include <vector>
+
+using std::vector;
+
+
+static vector<float> makeValues(int n,float offset)
+{
+  vector<float> result(n);
+
+  for (int i=0; i!=n; ++i) {
+    result[i] = i*0.37f + offset;
+  }
+
+  return result;
+}
+
+
+static void testKernelsMatchScalar(const FloatKernels &kernels)
+{
+  const FloatKernels &scalar = scalarFloatKernels();
+
+  // Sizes that exercise both the vector loops and the remainders.
+  for (int n : {0,1,2,3,4,5,7,8,9,15,16,17,33}) {
+    vector<float> a = makeValues(n,1);
+    vector<float> b = makeValues(n,3.5);
+    vector<float> expected(n), result(n);
+
+    scalar.add(a.data(),b.data(),expected.data(),n);
+    kernels.add(a.data(),b.data(),result.data(),n);
+    assert(result==expected);
+
+    scalar.subtract(a.data(),b.data(),expected.data(),n);
+    kernels.subtract(a.data(),b.data(),result.data(),n);
+    assert(result==expected);
+
+    scalar.scale(a.data(),1.5,expected.data(),n);
+    kernels.scale(a.data(),1.5,result.data(),n);
+    assert(result==expected);
+
+    scalar.divide(a.data(),3,expected.data(),n);
+    kernels.divide(a.data(),3,result.data(),n);
+    assert(result==expected);
+  }
+}
+
+
+static void testScalar()
+{
+  float a[] = {1,2,3};
+  float b[] = {4,5,6};
+  float result[3];
+  scalarFloatKernels().add(a,b,result,3);
+  assert(result[0]==5 && result[1]==7 && result[2]==9);
+  scalarFloatKernels().divide(a,2,result,3);
+  assert(result[0]==0.5 && result[1]==1 && result[2]==1.5);
+}
+
+
+int main()
+{
+  testScalar();
+
+  for (const FloatKernels *kernels_ptr : availableFloatKernels()) {
+    testKernelsMatchScalar(*kernels_ptr);
+  }
+
+  assert(availableFloatKernels().back()==&floatKernels());
+}
@@ -0,0 +1,137 @@
+#ifndef FLOATVECTOR_HPP_
+#define FLOATVECTOR_HPP_
+
+#include <cassert>
+#include <algorithm>
+#include <initializer_list>
+
+
+// A fixed-size sequence of floats.  Small vectors, such as points, are
+// stored inline so that they don't require a heap allocation.
+class FloatVector {
+  public:
+    static constexpr int max_inline_size = 4;
+
+    FloatVector()
+    : _size(0)
+    {
+    }
+
+    explicit FloatVector(int size_arg)
+    : _size(size_arg)
+    {
+      assert(size_arg>=0);
+
+      if (!isInline()) {
+        _values.heap_ptr = new float[_size];
+      }
+
+      std::fill(begin(),end(),0);
+    }
+
+    FloatVector(std::initializer_list<float> values)
+    : FloatVector(values.size())
+    {
+      std::copy(values.begin(),values.end(),begin());
+    }
+
+    FloatVector(const FloatVector &arg)
+    : FloatVector(arg._size)
+    {
+      std::copy(arg.begin(),arg.end(),begin());
+    }
+
+    FloatVector(FloatVector &&arg)
+    : _size(arg._size),
+      _values(arg._values)
+    {
+      arg._size = 0;
+    }
+
+    ~FloatVector()
+    {
+      if (!isInline()) {
+        delete [] _values.heap_ptr;
+      }
+    }
+
+    FloatVector &operator=(const FloatVector &arg)
+    {
+      if (this==&arg) return *this;
+
+      if (arg._size!=_size) {
+        *this = FloatVector(arg);
+        return *this;
+      }
+
+      std::copy(arg.begin(),arg.end(),begin());
+      return *this;
+    }
+
+    FloatVector &operator=(FloatVector &&arg)
+    {
+      if (this==&arg) return *this;
+
+      if (!isInline()) {
+        delete [] _values.heap_ptr;
+      }
+
+      _size = arg._size;
+      _values = arg._values;
+      arg._size = 0;
+      return *this;
+    }
+
+    int size() const { return _size; }
+
+    float *begin() { return data(); }
+    float *end() { return data() + _size; }
+    const float *begin() const { return data(); }
+    const float *end() const { return data() + _size; }
+
+    float &operator[](int index)
+    {
+      assert(index>=0 && index<_size);
+      return data()[index];
+    }
+
+    float operator[](int index) const
+    {
+      assert(index>=0 && index<_size);
+      return data()[index];
+    }
+
+    bool operator==(const FloatVector &arg) const
+    {
+      return _size==arg._size && std::equal(begin(),end(),arg.begin());
+    }
+
+    bool operator!=(const FloatVector &arg) const
+    {
+      return !operator==(arg);
+    }
+
+  private:
+    union Values {
+      float inline_values[max_inline_size];
+      float *heap_ptr;
+    };
+
+    bool isInline() const { return _size<=max_inline_size; }
+
+    float *data()
+    {
+      return isInline() ? _values.inline_values : _values.heap_ptr;
+    }
+
+    const float *data() const
+    {
+      return isInline() ? _values.inline_values : _values.heap_ptr;
+    }
+
+    int _size;
+    Values _values;
+};
+
+
+#endif /* FLOATVECTOR_HPP_ */
@@ -0,0 +1,57 @@
+#include "floatvector.hpp"
+
+#include <utility>
+
+
+static void testInline()
+{
+  FloatVector v{1,2};
+  assert(v.size()==2);
+  assert(v[0]==1);
+  assert(v[1]==2);
+
+  FloatVector v2 = v;
+  v2[1] = 3;
+  assert(v[1]==2);
+  assert(v!=v2);
+
+  v2 = v;
+  assert(v==v2);
+}
+
+
+static void testLarge()
+{
+  FloatVector v{1,2,3,4,5,6};
+  assert(v.size()==6);
+  assert(v[5]==6);
+
+  FloatVector v2 = v;
+  assert(v2==v);
+  v2[5] = 7;
+  assert(v[5]==6);
+
+  FloatVector v3 = std::move(v2);
+  assert(v3[5]==7);
+  assert(v2.size()==0);
+
+  v3 = FloatVector{1,2};
+  assert(v3.size()==2);
+  v3 = v;
+  assert(v3==v);
+}
+
+
+static void testZeroFilled()
+{
+  FloatVector v(3);
+  assert(v==(FloatVector{0,0,0}));
+}
+
+
+int main()
+{
+  testInline();
+  testLarge();
+  testZeroFilled();
+}
@@ -7,6 +7,16 @@ using std::vector;
 
 Optional<Point2D> maybePoint2D(const Any &arg)
 {
+  if (arg.isFloatVector()) {
+    const FloatVector &arg_vector = arg.asFloatVector();
+
+    if (arg_vector.size()!=2) {
+      return {};
+    }
+
+    return Point2D(arg_vector[0],arg_vector[1]);
+  }
+
   if (!arg.isVector()) {
     return {};
   }
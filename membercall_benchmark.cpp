@@ -0,0 +1,96 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <functional>
+#include "any.hpp"
+#include "scene.hpp"
+#include "sceneobjects.hpp"
+#include "compilestatement.hpp"
+#include "expressionvm.hpp"
+
+using std::vector;
+using std::cout;
+using std::string;
+using Clock = std::chrono::steady_clock;
+using Opcode = CompiledExpression::Opcode;
+
+
+// This compares calling a body method by getting the member as a Function
+// and then calling it, which is what happened before objects had method
+// tables, with calling the method through the method table.
+
+
+static double nanosecondsPerCall(const std::function<void()> &f)
+{
+  int n_repetitions = 1<<20;
+  Clock::time_point start_time = Clock::now();
+
+  for (int i=0; i!=n_repetitions; ++i) {
+    f();
+  }
+
+  std::chrono::duration<double,std::nano> duration = Clock::now() - start_time;
+  return duration.count()/n_repetitions;
+}
+
+
+// Turn the member_method and method_call instructions back into member
+// and call instructions, so that we get the bytecode that we would have
+// had without method tables.
+static CompiledExpression withoutMethodCalls(CompiledExpression expression)
+{
+  for (CompiledExpression::Instruction &instruction :
+       expression.instructions) {
+    if (instruction.opcode==Opcode::member_method) {
+      instruction.opcode = Opcode::member;
+    }
+    else if (instruction.opcode==Opcode::method_call) {
+      instruction.opcode = Opcode::call;
+    }
+  }
+
+  return expression;
+}
+
+
+static void benchmarkExpression(const string &text,Environment &environment)
+{
+  std::ostringstream error_stream;
+  vector<Any> input_values;
+  vector<Any> stack;
+  vector<const Object::Method *> method_stack;
+  CompiledExpression method_expression = compileExpression(text);
+
+  CompiledExpression member_expression =
+    withoutMethodCalls(method_expression);
+
+  volatile bool sink = false;
+
+  auto report = [&](const string &name,const std::function<void()> &f){
+    cout << "  " << name << ": " << nanosecondsPerCall(f) << " ns\n";
+  };
+
+  auto evaluate = [&](const CompiledExpression &expression){
+    return
+      evaluateCompiledExpression(
+        expression,
+        {input_values,error_stream,&environment,stack,method_stack}
+      );
+  };
+
+  cout << text << " (ns per evaluation)\n";
+  report("member then call",[&]{ sink = !!evaluate(member_expression); });
+  report("method call",[&]{ sink = !!evaluate(method_expression); });
+}
+
+
+int main()
+{
+  Scene scene;
+  Scene::Body &body = scene.addBody("body");
+  Environment environment;
+  environment["body"] = makeBodyObject(BodyLink(&scene,&body));
+  benchmarkExpression("body.pos()",environment);
+  benchmarkExpression("body.pos([1,2])",environment);
+  benchmarkExpression("body.globalVec([1,2])",environment);
+}
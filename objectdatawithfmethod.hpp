@@ -1,6 +1,6 @@
 struct ObjectDataWithFMethod : Object::Data {
   ObjectDataWithFMethod(
-    std::function<Optional<Any>(const std::vector<Any> &)> f_arg
+    std::function<Optional<Any>(const Arguments &)> f_arg
   ): f(std::move(f_arg))
   {
   }
@@ -9,9 +9,11 @@ struct ObjectDataWithFMethod : Object::Data {
 
   std::string typeName() const override { return "Test"; }
 
-  Any member(const std::string &member_name) const override
+  Any member(const Symbol &member_name) const override
   {
-    if (member_name=="f") {
+    static const Symbol f_symbol("f");
+
+    if (member_name==f_symbol) {
       return Function{f};
     }
 
@@ -24,5 +26,5 @@ struct ObjectDataWithFMethod : Object::Data {
     return {"f"};
   }
 
-  std::function<Optional<Any>(const std::vector<Any> &)> f;
+  std::function<Optional<Any>(const Arguments &)> f;
 };
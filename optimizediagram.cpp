@@ -0,0 +1,171 @@
+#include "optimizediagram.hpp"
+
+#include <cassert>
+#include <ostream>
+
+using std::vector;
+using std::string;
+using std::ostream;
+using Opcode = CompiledExpression::Opcode;
+
+
+static vector<int> statementInputIndices(const CompiledStatement &statement)
+{
+  vector<int> input_indices;
+
+  for (auto &instruction : statement.expression.instructions) {
+    if (instruction.opcode==Opcode::push_input) {
+      input_indices.push_back(instruction.operand);
+    }
+  }
+
+  return input_indices;
+}
+
+
+static int statementWithOutput(const DiagramNode &node,int output_index)
+{
+  int n_statements = node.statements.size();
+  int next_output_index = 0;
+
+  for (int i=0; i!=n_statements; ++i) {
+    if (node.statements[i].has_output) {
+      if (next_output_index==output_index) {
+        return i;
+      }
+
+      ++next_output_index;
+    }
+  }
+
+  return -1;
+}
+
+
+DiagramOptimization optimizeDiagram(const Diagram &diagram)
+{
+  DiagramOptimization result;
+  result.nodes.resize(diagram.nNodes());
+
+  struct StatementRef {
+    NodeIndex node_index;
+    int statement_index;
+  };
+
+  vector<StatementRef> statements_to_visit;
+
+  auto need = [&](NodeIndex node_index,int statement_index){
+    DiagramOptimization::Node &node = result.nodes[node_index];
+
+    if (node.needed_statements[statement_index]) {
+      return;
+    }
+
+    node.is_needed = true;
+    node.needed_statements[statement_index] = true;
+    statements_to_visit.push_back({node_index,statement_index});
+  };
+
+  vector<NodeIndex> node_indices = diagram.existingNodeIndices();
+
+  for (NodeIndex node_index : node_indices) {
+    const DiagramNode &node = diagram.node(node_index);
+    DiagramOptimization::Node &optimized_node = result.nodes[node_index];
+    optimized_node.needed_statements.resize(node.statements.size(),false);
+    optimized_node.needed_inputs.resize(node.nInputs(),false);
+  }
+
+  for (NodeIndex node_index : node_indices) {
+    const DiagramNode &node = diagram.node(node_index);
+    int n_statements = node.statements.size();
+
+    for (int i=0; i!=n_statements; ++i) {
+      if (node.statements[i].compiled.hasEffects()) {
+        need(node_index,i);
+      }
+    }
+  }
+
+  while (!statements_to_visit.empty()) {
+    StatementRef ref = statements_to_visit.back();
+    statements_to_visit.pop_back();
+    const DiagramNode &node = diagram.node(ref.node_index);
+
+    const CompiledStatement &statement =
+      node.statements[ref.statement_index].compiled;
+
+    for (int input_index : statementInputIndices(statement)) {
+      if (input_index>=node.nInputs()) {
+        continue;
+      }
+
+      result.nodes[ref.node_index].needed_inputs[input_index] = true;
+      const DiagramNode::Input &input = node.inputs[input_index];
+
+      if (input.source_node_index<0 || input.source_output_index<0) {
+        continue;
+      }
+
+      int source_statement_index =
+        statementWithOutput(
+          diagram.node(input.source_node_index),
+          input.source_output_index
+        );
+
+      if (source_statement_index>=0) {
+        need(input.source_node_index,source_statement_index);
+      }
+    }
+  }
+
+  return result;
+}
+
+
+static string withoutTrailingSpaces(string text)
+{
+  while (!text.empty() && text.back()==' ') {
+    text.pop_back();
+  }
+
+  return text;
+}
+
+
+void
+  printOn(
+    ostream &stream,
+    const Diagram &diagram,
+    const DiagramOptimization &optimization
+  )
+{
+  for (NodeIndex node_index : diagram.existingNodeIndices()) {
+    const DiagramNode &node = diagram.node(node_index);
+    const DiagramOptimization::Node &optimized_node =
+      optimization.nodes[node_index];
+
+    stream << "node " << node_index;
+
+    if (!optimized_node.is_needed) {
+      stream << ": skipped";
+    }
+
+    stream << "\n";
+
+    int n_statements = node.statements.size();
+
+    for (int i=0; i!=n_statements; ++i) {
+      const CompiledStatement &statement = node.statements[i].compiled;
+      bool is_needed = optimized_node.needed_statements[i];
+      stream << "  " << (is_needed ? "evaluate" : "skip") << ": ";
+      stream << withoutTrailingSpaces(statement.text);
+      int n_folded_operations = statement.expression.n_folded_operations;
+
+      if (n_folded_operations!=0) {
+        stream << " (" << n_folded_operations << " folded)";
+      }
+
+      stream << "\n";
+    }
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef OPTIMIZEDIAGRAM_HPP_
+#define OPTIMIZEDIAGRAM_HPP_
+
+#include <vector>
+#include <iosfwd>
+#include "diagram.hpp"
+
+
+// This says which parts of a diagram need to be evaluated for the diagram
+// to have its effects.  Shows, returns and assignments are always needed,
+// along with everything that they depend on.  Everything else can be
+// skipped, as long as nobody is looking at the node states.
+struct DiagramOptimization {
+  struct Node {
+    bool is_needed = false;
+    std::vector<bool> needed_statements;
+    std::vector<bool> needed_inputs;
+  };
+
+  std::vector<Node> nodes;
+    // This is indexed by the node index.
+};
+
+
+extern DiagramOptimization optimizeDiagram(const Diagram &);
+
+// Show what will be evaluated and what will be skipped.
+extern void
+  printOn(std::ostream &,const Diagram &,const DiagramOptimization &);
+
+
+#endif /* OPTIMIZEDIAGRAM_HPP_ */
@@ -0,0 +1,87 @@
+#include "optimizediagram.hpp"
+
+#include <cassert>
+#include <sstream>
+
+using std::string;
+using std::to_string;
+using std::ostringstream;
+
+
+static string optimizationText(const Diagram &diagram)
+{
+  ostringstream stream;
+  printOn(stream,diagram,optimizeDiagram(diagram));
+  return stream.str();
+}
+
+
+static void testSkippingUnusedStatements()
+{
+  Diagram diagram;
+  NodeIndex x_node = diagram.createNodeWithText("x");
+  NodeIndex unused_node = diagram.createNodeWithText("[1,2]*2");
+  NodeIndex add_node = diagram.createNodeWithText("$+1\n7");
+  NodeIndex return_node = diagram.createNodeWithText("return $");
+  diagram.connectNodes(x_node,0,add_node,0);
+  diagram.connectNodes(add_node,0,return_node,0);
+
+  DiagramOptimization optimization = optimizeDiagram(diagram);
+  assert(optimization.nodes[x_node].is_needed);
+  assert(!optimization.nodes[unused_node].is_needed);
+  assert(optimization.nodes[add_node].needed_statements[0]);
+  assert(!optimization.nodes[add_node].needed_statements[1]);
+  assert(optimization.nodes[add_node].needed_inputs[0]);
+  assert(optimization.nodes[return_node].is_needed);
+
+  string expected_text =
+    "node " + to_string(x_node) + "\n"
+    "  evaluate: x\n"
+    "node " + to_string(unused_node) + ": skipped\n"
+    "  skip: [1,2]*2 (2 folded)\n"
+    "node " + to_string(add_node) + "\n"
+    "  evaluate: $+1\n"
+    "  skip: 7\n"
+    "node " + to_string(return_node) + "\n"
+    "  evaluate: return $\n";
+
+  assert(optimizationText(diagram)==expected_text);
+}
+
+
+static void testEffectsAreNeeded()
+{
+  Diagram diagram;
+  NodeIndex show_node = diagram.createNodeWithText("show($)");
+  NodeIndex source_node = diagram.createNodeWithText("5");
+  NodeIndex assignment_node = diagram.createNodeWithText("a=1");
+  diagram.connectNodes(source_node,0,show_node,0);
+
+  DiagramOptimization optimization = optimizeDiagram(diagram);
+  assert(optimization.nodes[show_node].is_needed);
+  assert(optimization.nodes[source_node].is_needed);
+  assert(optimization.nodes[assignment_node].is_needed);
+}
+
+
+static void testKeepingTheOptimization()
+{
+  Diagram diagram;
+  NodeIndex x_node = diagram.createNodeWithText("x");
+  NodeIndex return_node = diagram.createNodeWithText("return $");
+  const Diagram &const_diagram = diagram;
+  const DiagramOptimization *optimization_ptr = &const_diagram.optimization();
+  assert(!optimization_ptr->nodes[x_node].is_needed);
+  assert(&const_diagram.optimization()==optimization_ptr);
+
+  diagram.connectNodes(x_node,0,return_node,0);
+  assert(const_diagram.optimization().nodes[x_node].is_needed);
+}
+
+
+int main()
+{
+  testSkippingUnusedStatements();
+  testEffectsAreNeeded();
+  testKeepingTheOptimization();
+}
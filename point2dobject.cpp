@@ -4,10 +4,9 @@
 
 
 using std::make_unique;
-using std::vector;
 
 
 Any makePoint2DObject(const Point2D &point)
 {
-  return vector<Any>{point.x,point.y};
+  return FloatVector{point.x,point.y};
 }
@@ -67,6 +67,15 @@ struct PrimaryValuePolicy {
     return _possible_values.numeric_value;
   }
 
+  static bool
+    differentTypesAreEqual(
+      const PrimaryValuePolicy &,
+      const PrimaryValuePolicy &
+    )
+  {
+    return false;
+  }
+
   std::string typeName() const
   {
     switch (_type) {
@@ -328,7 +328,7 @@ static vector<T> operator+(const vector<T> &a,const vector<T> &b)
 
 void QtDiagramEditor::drawNode(NodeIndex node_index)
 {
-  const Node &node = this->node(node_index);
+  const Node &node = constDiagram().node(node_index);
   NodeRenderInfo render_info = nodeRenderInfo(node);
 
   bool is_selected = nodeIsSelected(node_index);
@@ -386,7 +386,8 @@ void QtDiagramEditor::drawNode(NodeIndex node_index)
     const Node::Input &input = node.inputs[i];
 
     if (input.source_node_index>=0) {
-      const Node& source_node = this->node(input.source_node_index);
+      const Node& source_node =
+        constDiagram().node(input.source_node_index);
       int source_output_index = input.source_output_index;
       ViewportCircle source_circle =
         nodeOutputCircle(source_node,source_output_index);
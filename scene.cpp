@@ -26,6 +26,17 @@ Scene::Scene()
 }
 
 
+Scene::Scene(const Scene &arg)
+: n_frame_variables(arg.n_frame_variables),
+  root_body(arg.root_body),
+  background_motion(arg.background_motion),
+  current_frame_index(arg.current_frame_index),
+  display_frame(arg.display_frame)
+{
+  indexBodiesOf(root_body);
+}
+
+
 Scene::~Scene()
 {
 }
@@ -87,41 +98,107 @@ auto Scene::addBody(const std::string &name) -> Body &
 
 Body &Scene::addBody(const std::string &name,const Point2DMap &position_map)
 {
-  return bodies().createChild(Body(name,position_map,/*parent_ptr*/&root_body));
+  Body &body =
+    bodies().createChild(Body(name,position_map,/*parent_ptr*/&root_body));
+
+  body_index.emplace(name,&body);
+  return body;
 }
 
 
 Body& Scene::addChildBodyTo(Body &parent)
 {
-  return parent.addChild(newBodyName(),newPositionMap());
+  Body &body = parent.addChild(newBodyName(),newPositionMap());
+  body_index.emplace(body.name(),&body);
+  return body;
 }
 
 
 void Scene::removeChildBodyFrom(Body &parent,int child_index)
 {
+  unindexBody(parent.child(child_index));
   parent.removeChild(child_index);
 }
 
 
-bool Scene::hasBody(const Bodies &bodies,const std::string &name) const
+void Scene::setBodyName(Body &body,const std::string &new_name)
+{
+  removeFromIndex(body);
+  body.name_member = new_name;
+  body_index.emplace(new_name,&body);
+}
+
+
+auto Scene::maybeBody(const std::string &name) -> Body *
 {
-  for (const Body &body : bodies) {
-    if (body.name==name) {
-      return true;
+  auto range = body_index.equal_range(name);
+  Body *found_body_ptr = nullptr;
+
+  for (auto iter = range.first; iter!=range.second; ++iter) {
+    Body *body_ptr = iter->second;
+
+    if (body_ptr->parentPtr()!=&root_body) {
+      continue;
     }
 
-    if (hasBody(body.children,name)) {
-      return true;
+    if (found_body_ptr) {
+      // There is more than one body with this name, so use the first
+      // one in order.
+      for (int i=0, n=nBodies(); i!=n; ++i) {
+        if (body(i).name()==name) {
+          return &body(i);
+        }
+      }
+
+      assert(false);
     }
+
+    found_body_ptr = body_ptr;
   }
 
-  return false;
+  return found_body_ptr;
 }
 
 
 bool Scene::hasBody(const std::string &name) const
 {
-  return hasBody(bodies(),name);
+  return body_index.count(name)!=0;
+}
+
+
+void Scene::indexBodiesOf(Body &parent)
+{
+  for (auto &body_ptr : parent.children.body_ptrs) {
+    // Copied bodies still point to the parent they were copied from.
+    body_ptr->parent_ptr = &parent;
+    body_index.emplace(body_ptr->name(),body_ptr.get());
+    indexBodiesOf(*body_ptr);
+  }
+}
+
+
+void Scene::removeFromIndex(Body &body)
+{
+  auto range = body_index.equal_range(body.name());
+
+  for (auto iter = range.first; iter!=range.second; ++iter) {
+    if (iter->second==&body) {
+      body_index.erase(iter);
+      return;
+    }
+  }
+
+  assert(false);
+}
+
+
+void Scene::unindexBody(Body &body)
+{
+  removeFromIndex(body);
+
+  for (auto &child_ptr : body.children.body_ptrs) {
+    unindexBody(*child_ptr);
+  }
 }
 
 
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <cassert>
 #include <functional>
 #include "point2d.hpp"
@@ -20,8 +22,11 @@ class Scene {
     using VarValue = float;
 
     Scene();
+    Scene(const Scene &);
     ~Scene();
 
+    Scene &operator=(const Scene &) = delete;
+
     static VarIndex noVarIndex() { return -1; }
     int nBodies() const { return bodies().size(); }
     Body &addBody();
@@ -29,6 +34,10 @@ class Scene {
     Body &addBody(const std::string &name,const Point2DMap &position_map);
     Body& addChildBodyTo(Body &parent);
     void removeChildBodyFrom(Body &parent,int child_index);
+    void setBodyName(Body &,const std::string &new_name);
+    Body *maybeBody(const std::string &name);
+      // Find the body with the given name that is directly in the scene,
+      // as opposed to being the child of another body.
     const Bodies &bodies() const { return root_body.children; }
     Bodies &bodies() { return root_body.children; }
     Body &body(int index) { return bodies()[index]; }
@@ -192,13 +201,14 @@ class Scene {
             Body *parent_ptr_arg
           )
         : position_map(position_arg),
-          name(name_arg),
-          parent_ptr(parent_ptr_arg)
+          parent_ptr(parent_ptr_arg),
+          name_member(name_arg)
         {
         }
 
         Point2DMap position_map;
-        std::string name;
+
+        const std::string &name() const { return name_member; }
 
         int nChildren() const { return children.size(); }
 
@@ -230,6 +240,10 @@ class Scene {
       private:
         Bodies children;
         Body *parent_ptr;
+        std::string name_member;
+          // This is private so that the scene can keep its index of
+          // bodies by name up to date.  Use Scene::setBodyName() to
+          // change it.
 
         friend class Scene;
 
@@ -258,9 +272,16 @@ class Scene {
     int current_frame_index = 0;
     Frame display_frame;
 
+    std::unordered_multimap<std::string,Body *> body_index;
+      // All the bodies in the scene, including children, by name.  Names
+      // aren't required to be unique, so there can be more than one body
+      // with the same name.
+
     std::string newBodyName() const;
-    bool hasBody(const Bodies &bodies,const std::string &name) const;
     bool hasBody(const std::string &name) const;
+    void indexBodiesOf(Body &parent);
+    void removeFromIndex(Body &body);
+    void unindexBody(Body &body);
     void addVars(int n_vars);
     Point2DMap newPositionMap();
 };
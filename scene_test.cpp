@@ -15,12 +15,12 @@ static void testCreatingBodies()
   assert(scene.nFrameVariables()==0);
   scene.addBody();
   assert(scene.nFrameVariables()==2);
-  assert(scene.bodies()[0].name=="Body1");
+  assert(scene.bodies()[0].name()=="Body1");
   scene.addBody();
-  assert(scene.bodies()[1].name=="Body2");
+  assert(scene.bodies()[1].name()=="Body2");
   assert(scene.nFrameVariables()==4);
   scene.addChildBodyTo(scene.bodies()[0]);
-  assert(scene.bodies()[0].child(0).name=="Body3");
+  assert(scene.bodies()[0].child(0).name()=="Body3");
   assert(scene.nFrameVariables()==6);
   assert(scene.backgroundFrame().nVariables()==6);
 }
@@ -74,6 +74,46 @@ static void testGlobalPos2()
 }
 
 
+static void testFindingBodiesByName()
+{
+  Scene scene;
+  Scene::Body &body1 = scene.addBody();
+  Scene::Body &body2 = scene.addChildBodyTo(body1);
+  assert(scene.maybeBody("Body1")==&body1);
+
+  // Only bodies directly in the scene are found.
+  assert(!scene.maybeBody("Body2"));
+  assert(body2.parentPtr()==&body1);
+
+  scene.setBodyName(body1,"Renamed");
+  assert(!scene.maybeBody("Body1"));
+  assert(scene.maybeBody("Renamed")==&body1);
+
+  // Body1 isn't used any more, so it can be used again.
+  Scene::Body &body3 = scene.addBody();
+  assert(body3.name()=="Body1");
+  assert(scene.maybeBody("Body1")==&body3);
+
+  // Bodies with the same name are found in order.
+  scene.setBodyName(body3,"Renamed");
+  assert(scene.maybeBody("Renamed")==&body1);
+
+  {
+    Scene copy = scene;
+    assert(copy.maybeBody("Renamed")==&copy.body(0));
+    assert(copy.body(0).child(0).parentPtr()==&copy.body(0));
+  }
+
+  scene.removeChildBodyFrom(scene.rootBody(),0);
+  assert(scene.maybeBody("Renamed")==&body3);
+
+  // Removing a body removes its children too, so their names can be
+  // used again.
+  assert(scene.addBody().name()=="Body1");
+  assert(scene.addChildBodyTo(body3).name()=="Body2");
+}
+
+
 int main()
 {
   testCreatingBodies();
@@ -81,4 +121,5 @@ int main()
   testParentBody();
   testGlobalPos();
   testGlobalPos2();
+  testFindingBodiesByName();
 }
@@ -10,20 +10,23 @@ using std::vector;
 using std::make_unique;
 
 
-Any SceneObjectData::member(const std::string &member_name) const
+Optional<Any> SceneObjectData::maybeMember(const Symbol &member_name) const
 {
-  auto n_bodies = scene.nBodies();
+  Scene::Body *body_ptr = scene.maybeBody(member_name.str());
 
-  for (auto i=n_bodies*0; i!=n_bodies; ++i) {
-    Scene::Body &body = scene.body(i);
-
-    // This is where we check to see if we have a body in the scene.
-    if (body.name==member_name) {
-      return makeBodyObject(BodyLink(&scene,&body));
-    }
+  if (!body_ptr) {
+    return {};
   }
 
-  assert(false);
+  return Any(makeBodyObject(BodyLink(&scene,body_ptr),display_frames_ptr));
+}
+
+
+Any SceneObjectData::member(const Symbol &member_name) const
+{
+  Optional<Any> maybe_body = maybeMember(member_name);
+  assert(maybe_body);
+  return std::move(*maybe_body);
 }
 
 
@@ -35,16 +38,14 @@ std::vector<std::string> BodyObjectData::memberNames() const
 
 static Any makeVector(const Point2D &result_value)
 {
-  vector<Any> result;
-  result.push_back(result_value.x);
-  result.push_back(result_value.y);
-  return Any(std::move(result));
+  return FloatVector{result_value.x,result_value.y};
 }
 
 
 static Any
-  bodyPosFunction(const BodyLink &body_link,const vector<Any> &parameters)
+  bodyPosFunction(const BodyObjectData &data,const Arguments &parameters)
 {
+  const BodyLink &body_link = data.body_link;
   int n_parameters = parameters.size();
 
   if (n_parameters==0) {
@@ -52,7 +53,7 @@ static Any
       globalPos(
         body_link.body(),
         /*local*/Point2D(0,0),
-        body_link.scene().displayFrame()
+        displayFrameOf(body_link.scene(),data.display_frames_ptr)
       );
     return makePoint2DObject(result);
   }
@@ -77,47 +78,86 @@ static Any
     return makeVector(local);
   }
 
-  const Scene::Frame &frame = body_link.scene().displayFrame();
+  const Scene::Frame &frame =
+    displayFrameOf(body_link.scene(),data.display_frames_ptr);
+
   const Scene::Body &body = body_link.body();
   Point2D result_value = globalPos(body,local,frame);
   return makeVector(result_value);
 }
 
 
-Any BodyObjectData::member(const std::string &member_name) const
+static const BodyObjectData &bodyDataOf(const Object::Data &data)
 {
-  if (member_name=="globalVec") {
-    return {
-      Function{
-        [body_link=body_link](const vector<Any> &parameters) -> Optional<Any> {
-          if (parameters.size()!=1) {
-            assert(false);
-          }
-          Optional<Point2D> maybe_point2d = maybePoint2D(parameters[0]);
+  return static_cast<const BodyObjectData &>(data);
+}
 
-          if (!maybe_point2d) {
-            assert(false);
-          }
 
-          Vector2D result_value =
-            globalVec(body_link,*maybe_point2d - Point2D(0,0));
-          vector<Any> result;
-          result.push_back(result_value.x);
-          result.push_back(result_value.y);
-          return Any(std::move(result));
-        }
-      }
-    };
+static const BodyLink &bodyLinkOf(const Object::Data &data)
+{
+  return bodyDataOf(data).body_link;
+}
+
+
+static Optional<Any>
+  bodyGlobalVecMethod(const Object::Data &data,const Arguments &parameters)
+{
+  if (parameters.size()!=1) {
+    assert(false);
+  }
+
+  Optional<Point2D> maybe_point2d = maybePoint2D(parameters[0]);
+
+  if (!maybe_point2d) {
+    assert(false);
   }
 
-  if (member_name=="pos") {
-    return {
-      Function{
-        [body_link=body_link](const vector<Any> &parameters) -> Optional<Any> {
-          return bodyPosFunction(body_link,parameters);
+  Vector2D result_value =
+    globalVec(bodyLinkOf(data),*maybe_point2d - Point2D(0,0));
+  return Any(FloatVector{result_value.x,result_value.y});
+}
+
+
+static Optional<Any>
+  bodyPosMethod(const Object::Data &data,const Arguments &parameters)
+{
+  return bodyPosFunction(bodyDataOf(data),parameters);
+}
+
+
+const Object::MethodTable &BodyObjectData::methods() const
+{
+  static const Object::MethodTable methods = {
+    {Symbol("globalVec"),bodyGlobalVecMethod},
+    {Symbol("pos"),bodyPosMethod},
+  };
+
+  return methods;
+}
+
+
+Optional<Any> BodyObjectData::maybeMember(const Symbol &member_name) const
+{
+  // The members of a body are just its methods.
+  return maybeMethodMember(member_name);
+}
+
+
+Any BodyObjectData::member(const Symbol &member_name) const
+{
+  // Getting a method as a value binds it to a copy of this body.  Calls
+  // through the method table don't need to do this.
+  for (const Object::Method &method : methods()) {
+    if (method.name==member_name) {
+      return {
+        Function{
+          [data=*this,call_ptr=method.call_ptr](const Arguments &parameters)
+          {
+            return call_ptr(data,parameters);
+          }
         }
-      }
-    };
+      };
+    }
   }
 
   cerr << "member_name: " << member_name << "\n";
@@ -125,13 +165,13 @@ Any BodyObjectData::member(const std::string &member_name) const
 }
 
 
-Object makeBodyObject(BodyLink body_link)
+Object makeBodyObject(BodyLink body_link,DisplayFrames *display_frames_ptr)
 {
-  return Object(make_unique<BodyObjectData>(body_link));
+  return Object(make_unique<BodyObjectData>(body_link,display_frames_ptr));
 }
 
 
-Object makeSceneObject(Scene &scene)
+Object makeSceneObject(Scene &scene,DisplayFrames *display_frames_ptr)
 {
-  return Object(make_unique<SceneObjectData>(scene));
+  return Object(make_unique<SceneObjectData>(scene,display_frames_ptr));
 }
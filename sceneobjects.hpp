@@ -1,28 +1,45 @@
 #include "bodylink.hpp"
 #include "any.hpp"
+#include "displayframes.hpp"
 
 
 struct BodyObjectData : Object::Data {
-  BodyObjectData(BodyLink body_link_arg)
-  : body_link(body_link_arg)
+  BodyObjectData(
+    BodyLink body_link_arg,
+    DisplayFrames *display_frames_ptr_arg = nullptr
+  )
+  : body_link(body_link_arg),
+    display_frames_ptr(display_frames_ptr_arg)
   {
   }
 
   Data *clone() override { return new BodyObjectData(*this); }
   std::string typeName() const override { return "Body"; }
-  Any member(const std::string &member_name) const override;
+  Any member(const Symbol &member_name) const override;
   std::vector<std::string> memberNames() const override;
+  Optional<Any> maybeMember(const Symbol &member_name) const override;
+  const Object::MethodTable &methods() const override;
 
   BodyLink body_link;
+  DisplayFrames *display_frames_ptr;
+    // Where the position of the body is found.  If this is null, it is
+    // the display frame of the body's scene.
 };
 
 
-extern Object makeBodyObject(BodyLink body_link);
+extern Object
+  makeBodyObject(
+    BodyLink body_link,DisplayFrames *display_frames_ptr = nullptr
+  );
 
 
 struct SceneObjectData : Object::Data {
-  SceneObjectData(Scene &scene_arg)
-  : scene(scene_arg)
+  SceneObjectData(
+    Scene &scene_arg,
+    DisplayFrames *display_frames_ptr_arg = nullptr
+  )
+  : scene(scene_arg),
+    display_frames_ptr(display_frames_ptr_arg)
   {
   }
 
@@ -33,7 +50,8 @@ struct SceneObjectData : Object::Data {
     return "Scene";
   }
 
-  Any member(const std::string &member_name) const override;
+  Any member(const Symbol &member_name) const override;
+  Optional<Any> maybeMember(const Symbol &member_name) const override;
 
   std::vector<std::string> memberNames() const override
   {
@@ -42,14 +60,17 @@ struct SceneObjectData : Object::Data {
 
     for (auto i=n_bodies*0; i!=n_bodies; ++i) {
       Scene::Body &body = scene.body(i);
-      names.push_back(body.name);
+      names.push_back(body.name());
     }
 
     return names;
   }
 
   Scene &scene;
+  DisplayFrames *display_frames_ptr;
+    // This is given to the body objects that are made from the scene.
 };
 
 
-extern Object makeSceneObject(Scene &scene);
+extern Object
+  makeSceneObject(Scene &scene,DisplayFrames *display_frames_ptr = nullptr);
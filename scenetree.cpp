@@ -40,7 +40,7 @@ static void
     const Scene::Frame &frame
   )
 {
-  new_body_item.label = body.name;
+  new_body_item.label = body.name();
   auto &new_position_item = addItemTo(new_body_item);
   new_position_item.label = "Position:";
   {
@@ -83,7 +83,7 @@ void SceneViewer::mousePressedAt(const ViewportPoint &p)
     cerr << "No body found\n";
   }
   else {
-    cerr << "found body " << body_ptr->name << "\n";
+    cerr << "found body " << body_ptr->name() << "\n";
     clicked_on_body_ptr = const_cast<Body*>(body_ptr);
     const Body &body = *body_ptr;
     maybe_body_click_down_position =
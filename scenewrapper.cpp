@@ -5,7 +5,6 @@
 #include <sstream>
 #include "float.hpp"
 #include "makestr.hpp"
-#include "namewrapper.hpp"
 
 using std::cerr;
 using std::vector;
@@ -202,6 +201,56 @@ struct Point2DMapWrapper : NoOperationWrapper<VoidWrapper> {
 }
 
 
+namespace {
+struct BodyNameWrapper : NoOperationWrapper<LeafWrapper<StringWrapper>> {
+  Scene &scene;
+  Scene::Body &body;
+  const WrapperData &wrapper_data;
+
+  BodyNameWrapper(
+    Scene &scene_arg,
+    Scene::Body &body_arg,
+    const WrapperData &wrapper_data_arg
+  )
+  : scene(scene_arg),
+    body(body_arg),
+    wrapper_data(wrapper_data_arg)
+  {
+  }
+
+  Label label() const override { return "name"; }
+
+  std::string value() const override
+  {
+    return body.name();
+  }
+
+  void
+    setValue(
+      const std::string &arg,
+      const TreePath &,
+      TreeObserver &
+    ) const override
+  {
+    // The name has to be set through the scene so that it can find
+    // the body by its new name.
+    scene.setBodyName(body,arg);
+    wrapper_data.callbacks.changed_func();
+  }
+
+  void setState(const WrapperState &new_state) const override
+  {
+    if (new_state.value.isString()) {
+      scene.setBodyName(body,new_state.value.asString());
+    }
+    else {
+      assert(false);
+    }
+  }
+};
+}
+
+
 namespace {
 struct BodyWrapper : VoidWrapper {
   Scene &scene;
@@ -246,11 +295,7 @@ struct BodyWrapper : VoidWrapper {
   void withChildWrapper(int child_index,const WrapperVisitor &visitor) const
   {
     if (child_index==name_index) {
-      auto changed_func = [&](const TreePath &,TreeObserver &){
-        wrapper_data.callbacks.changed_func();
-      };
-
-      visitor(NameWrapper{"name", body.name, changed_func});
+      visitor(BodyNameWrapper(scene,body,wrapper_data));
       return;
     }
 
@@ -281,7 +326,7 @@ struct BodyWrapper : VoidWrapper {
 
     for (const WrapperState &child_state : state.children) {
       if (child_state.tag=="name") {
-        body.name = child_state.value.asString();
+        scene.setBodyName(body,child_state.value.asString());
       }
       else if (child_state.tag=="position_map") {
         Point2DMapWrapper(
@@ -0,0 +1,32 @@
+#include "symbol.hpp"
+
+#include <ostream>
+#include <mutex>
+#include <unordered_set>
+
+using std::string;
+
+
+const string &Symbol::intern(const string &text)
+{
+  // These are never destroyed, since symbols may still be used while
+  // other static objects are being destroyed.
+  static std::mutex &mutex = *new std::mutex;
+  static std::unordered_set<string> &table = *new std::unordered_set<string>;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return *table.insert(text).first;
+}
+
+
+const string &Symbol::emptyString()
+{
+  static const string &empty_string = intern("");
+  return empty_string;
+}
+
+
+std::ostream &operator<<(std::ostream &stream,const Symbol &arg)
+{
+  return stream << arg.str();
+}
@@ -0,0 +1,59 @@
+#ifndef SYMBOL_HPP_
+#define SYMBOL_HPP_
+
+#include <string>
+#include <iosfwd>
+#include <functional>
+
+
+// A Symbol is an interned string.  All symbols with the same text refer
+// to the same string in a process-wide table, so symbols can be compared
+// and hashed by address.  Making a symbol requires looking up the table,
+// so symbols that are used repeatedly should be made once and kept.
+class Symbol {
+  public:
+    Symbol() : string_ptr(&emptyString()) {}
+      // The empty symbol.
+
+    explicit Symbol(const std::string &text) : string_ptr(&intern(text)) {}
+    explicit Symbol(const char *text) : Symbol(std::string(text)) {}
+
+    const std::string &str() const { return *string_ptr; }
+    bool empty() const { return string_ptr->empty(); }
+
+    bool operator==(const Symbol &arg) const
+    {
+      return string_ptr==arg.string_ptr;
+    }
+
+    bool operator!=(const Symbol &arg) const { return !operator==(arg); }
+
+    bool operator<(const Symbol &arg) const
+    {
+      // We order by the text so that iterating over containers of symbols
+      // doesn't depend on where the strings were allocated.
+      return string_ptr!=arg.string_ptr && *string_ptr<*arg.string_ptr;
+    }
+
+    size_t hash() const { return std::hash<const void *>()(string_ptr); }
+
+  private:
+    static const std::string &intern(const std::string &text);
+    static const std::string &emptyString();
+
+    const std::string *string_ptr;
+};
+
+
+extern std::ostream &operator<<(std::ostream &,const Symbol &);
+
+
+namespace std {
+template <>
+struct hash<Symbol> {
+  size_t operator()(const Symbol &arg) const { return arg.hash(); }
+};
+}
+
+
+#endif /* SYMBOL_HPP_ */
@@ -0,0 +1,49 @@
+#include "symbol.hpp"
+
+#include <cassert>
+#include <sstream>
+#include <set>
+
+
+static void testInterning()
+{
+  Symbol a("a");
+  Symbol a2(std::string("a"));
+  Symbol b("b");
+  assert(a==a2);
+  assert(a!=b);
+  assert(&a.str()==&a2.str());
+  assert(a.hash()==a2.hash());
+  assert(Symbol()==Symbol(""));
+  assert(Symbol().empty());
+  assert(!a.empty());
+}
+
+
+static void testOrdering()
+{
+  std::set<Symbol> symbols;
+  symbols.insert(Symbol("c"));
+  symbols.insert(Symbol("a"));
+  symbols.insert(Symbol("b"));
+  symbols.insert(Symbol("a"));
+  assert(symbols.size()==3);
+  assert(symbols.begin()->str()=="a");
+  assert(symbols.rbegin()->str()=="c");
+}
+
+
+static void testStreaming()
+{
+  std::ostringstream stream;
+  stream << Symbol("name");
+  assert(stream.str()=="name");
+}
+
+
+int main()
+{
+  testInterning();
+  testOrdering();
+  testStreaming();
+}
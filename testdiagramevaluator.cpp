@@ -8,14 +8,20 @@ using std::string;
 
 
 Optional<Any>
-  TestDiagramEvaluator::maybeEvaluate(
+  TestDiagramEvaluator::maybeEvaluateIn(
+    const DiagramExecutionContext &context,
     const Diagram &diagram,
     const Environment *parent_environment_ptr,
     const Optional<string> &optional_expected_type_name
   )
 {
   DiagramExecutor executor(context,parent_environment_ptr);
-  DiagramEvaluationState &diagram_state = diagram_state_map[&diagram];
+  DiagramEvaluationState *diagram_state_ptr;
+  {
+    std::lock_guard<std::mutex> lock(diagram_state_map_mutex);
+    diagram_state_ptr = &diagram_state_map[&diagram];
+  }
+  DiagramEvaluationState &diagram_state = *diagram_state_ptr;
   executor.optional_expected_return_type_name = optional_expected_type_name;
   evaluateDiagram(diagram,executor,diagram_state);
   return std::move(executor.maybe_return_value);
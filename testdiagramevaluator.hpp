@@ -1,9 +1,12 @@
+#include <map>
+#include <mutex>
 #include "abstractdiagramevaluator.hpp"
 #include "diagramevaluationstate.hpp"
 
 
 struct TestDiagramEvaluator : AbstractDiagramEvaluator {
   std::map<const Diagram *,DiagramEvaluationState> diagram_state_map;
+  std::mutex diagram_state_map_mutex;
 
   TestDiagramEvaluator(const DiagramExecutionContext &context)
   : AbstractDiagramEvaluator(context)
@@ -11,7 +14,8 @@ struct TestDiagramEvaluator : AbstractDiagramEvaluator {
   }
 
   Optional<Any>
-    maybeEvaluate(
+    maybeEvaluateIn(
+      const DiagramExecutionContext &,
       const Diagram &diagram,
       const Environment *parent_environment_ptr,
       const Optional<std::string> &optional_expected_return_type_name
@@ -0,0 +1,102 @@
+#include "threadpool.hpp"
+
+#include <cassert>
+
+using std::unique_lock;
+
+
+ThreadPool::ThreadPool(int n_threads)
+{
+  assert(n_threads>=1);
+
+  for (int thread_index=1; thread_index!=n_threads; ++thread_index) {
+    threads.emplace_back([this,thread_index]{ runThread(thread_index); });
+  }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+  {
+    unique_lock<std::mutex> lock(job_mutex);
+    is_stopping = true;
+  }
+
+  job_started.notify_all();
+
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+
+void ThreadPool::doTasks(unique_lock<std::mutex> &lock,int thread_index)
+{
+  while (job.next_task_index!=job.n_tasks) {
+    int task_index = job.next_task_index++;
+    const Task &task = *job.task_ptr;
+    lock.unlock();
+    task(task_index,thread_index);
+    lock.lock();
+    ++job.n_finished_tasks;
+
+    if (job.n_finished_tasks==job.n_tasks) {
+      job_finished.notify_all();
+    }
+  }
+}
+
+
+void ThreadPool::runThread(int thread_index)
+{
+  unique_lock<std::mutex> lock(job_mutex);
+  int last_job_number = 0;
+
+  for (;;) {
+    job_started.wait(lock,[&]{
+      return is_stopping || job_number!=last_job_number;
+    });
+
+    if (is_stopping) {
+      return;
+    }
+
+    last_job_number = job_number;
+    doTasks(lock,thread_index);
+  }
+}
+
+
+void ThreadPool::run(int n_tasks,const Task &task)
+{
+  auto runInOrder = [&]{
+    for (int task_index=0; task_index!=n_tasks; ++task_index) {
+      task(task_index,/*thread_index*/0);
+    }
+  };
+
+  if (threads.empty() || n_tasks<=1) {
+    // The pool is left free, so a single task can still use it.
+    runInOrder();
+    return;
+  }
+
+  unique_lock<std::mutex> run_lock(run_mutex,std::try_to_lock);
+
+  if (!run_lock) {
+    runInOrder();
+    return;
+  }
+
+  unique_lock<std::mutex> lock(job_mutex);
+  job.task_ptr = &task;
+  job.n_tasks = n_tasks;
+  job.next_task_index = 0;
+  job.n_finished_tasks = 0;
+  ++job_number;
+  job_started.notify_all();
+  doTasks(lock,/*thread_index*/0);
+
+  job_finished.wait(lock,[&]{ return job.n_finished_tasks==job.n_tasks; });
+  job.task_ptr = nullptr;
+}
@@ -0,0 +1,58 @@
+#ifndef THREADPOOL_HPP_
+#define THREADPOOL_HPP_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+// This runs a number of tasks at the same time using a fixed set of
+// threads.  The thread that starts the tasks does some of them too, so a
+// pool with one thread doesn't start any new threads.
+class ThreadPool {
+  public:
+    using Task = std::function<void(int task_index,int thread_index)>;
+      // The thread index is less than nThreads(), and no two tasks of
+      // the same run() that are running at the same time get the same
+      // thread index, so it can be used to pick scratch space.
+
+    explicit ThreadPool(int n_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    void operator=(const ThreadPool &) = delete;
+
+    int nThreads() const { return threads.size() + 1; }
+
+    // Runs task(i,thread_index) for each i from 0 to n_tasks-1 and waits
+    // for them all to finish.  If the pool is already busy, like when a
+    // task uses the same pool, the tasks are run in order on the calling
+    // thread instead.  A run of a single task doesn't make the pool busy.
+    void run(int n_tasks,const Task &task);
+
+  private:
+    struct Job {
+      const Task *task_ptr = nullptr;
+      int n_tasks = 0;
+      int next_task_index = 0;
+      int n_finished_tasks = 0;
+    };
+
+    std::vector<std::thread> threads;
+    std::mutex run_mutex;
+      // This is held while a job is running.
+    std::mutex job_mutex;
+    std::condition_variable job_started;
+    std::condition_variable job_finished;
+    Job job;
+    int job_number = 0;
+    bool is_stopping = false;
+
+    void runThread(int thread_index);
+    void doTasks(std::unique_lock<std::mutex> &,int thread_index);
+};
+
+
+#endif /* THREADPOOL_HPP_ */
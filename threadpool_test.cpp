@@ -0,0 +1,98 @@
+#include "threadpool.hpp"
+
+#include <cassert>
+#include <atomic>
+#include <chrono>
+
+using std::vector;
+
+
+static void testRunningEachTaskOnce()
+{
+  ThreadPool pool(4);
+  int n_tasks = 1000;
+  vector<std::atomic<int>> n_runs(n_tasks);
+  std::atomic<bool> thread_indices_are_valid(true);
+
+  for (int i=0; i!=3; ++i) {
+    pool.run(n_tasks,[&](int task_index,int thread_index){
+      if (thread_index<0 || thread_index>=pool.nThreads()) {
+        thread_indices_are_valid = false;
+      }
+
+      ++n_runs[task_index];
+    });
+  }
+
+  for (int i=0; i!=n_tasks; ++i) {
+    assert(n_runs[i]==3);
+  }
+
+  assert(thread_indices_are_valid);
+}
+
+
+static void testSingleThread()
+{
+  ThreadPool pool(1);
+  assert(pool.nThreads()==1);
+  vector<int> task_indices;
+
+  pool.run(3,[&](int task_index,int thread_index){
+    assert(thread_index==0);
+    task_indices.push_back(task_index);
+  });
+
+  assert((task_indices==vector<int>{0,1,2}));
+}
+
+
+static void testRunningFromATask()
+{
+  ThreadPool pool(3);
+  std::atomic<int> n_runs(0);
+
+  pool.run(4,[&](int,int){
+    pool.run(5,[&](int,int){ ++n_runs; });
+  });
+
+  assert(n_runs==20);
+}
+
+
+static void testRunningFromASingleTask()
+{
+  ThreadPool pool(3);
+  std::atomic<int> n_started(0);
+  std::atomic<bool> all_started(true);
+
+  pool.run(1,[&](int,int){
+    pool.run(3,[&](int,int){
+      ++n_started;
+
+      // This only finishes if the other tasks are on other threads.
+      auto end_time =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+      while (n_started!=3) {
+        if (std::chrono::steady_clock::now()>end_time) {
+          all_started = false;
+          return;
+        }
+
+        std::this_thread::yield();
+      }
+    });
+  });
+
+  assert(all_started);
+}
+
+
+int main()
+{
+  testRunningEachTaskOnce();
+  testSingleThread();
+  testRunningFromATask();
+  testRunningFromASingleTask();
+}
@@ -1,6 +1,10 @@
 #include "world.hpp"
 
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+#include <sstream>
 #include "worldwrapper.hpp"
 #include "generatename.hpp"
 #include "sceneobjects.hpp"
@@ -16,13 +20,21 @@ using std::vector;
 using Member = World::Member;
 using CharmapperMember = World::CharmapperMember;
 using SceneMember = World::SceneMember;
+using Clock = std::chrono::steady_clock;
 
 
 
 World::World()
+: World(std::max(1u,std::thread::hardware_concurrency()))
+{
+}
+
+
+World::World(int n_threads)
 : observed_diagrams([&](const Diagram &diagram){
     notifyDiagramChanged(diagram);
-  })
+  }),
+  thread_pool(n_threads)
 {
 }
 
@@ -168,78 +180,216 @@ void World::applyCharmaps()
 
 namespace {
 struct ObservedDiagramEvaluator : AbstractDiagramEvaluator {
-  ObservedDiagrams &observed_diagrams;
+  ObservedDiagrams *observed_diagrams_ptr;
+    // This is null if the results aren't going to be shown, in which
+    // case every diagram is treated as unobserved.
+  DiagramStatePool &unobserved_diagram_states;
+  vector<ObservedDiagram *> evaluated_observed_diagrams;
+  std::mutex evaluated_observed_diagrams_mutex;
 
   ObservedDiagramEvaluator(
     const DiagramExecutionContext &context,
-    ObservedDiagrams &observed_diagrams_arg
+    ObservedDiagrams *observed_diagrams_ptr_arg,
+    DiagramStatePool &unobserved_diagram_states_arg
   )
   : AbstractDiagramEvaluator(context),
-    observed_diagrams(observed_diagrams_arg)
+    observed_diagrams_ptr(observed_diagrams_ptr_arg),
+    unobserved_diagram_states(unobserved_diagram_states_arg)
   {
   }
 
   Optional<Any>
     maybeEvaluateWith(
+      const DiagramExecutionContext &context,
       DiagramEvaluationState &diagram_state,
       const Diagram &diagram,
       const Environment *parent_environment_ptr,
-      const Optional<string> &optional_expected_type_name
+      const Optional<string> &optional_expected_type_name,
+      const DiagramOptimization *optimization_ptr = nullptr
     )
   {
     DiagramExecutor executor(context,parent_environment_ptr);
     executor.optional_expected_return_type_name = optional_expected_type_name;
-    evaluateDiagram(diagram,executor,diagram_state);
+
+    if (optimization_ptr) {
+      evaluateDiagram(diagram,executor,diagram_state,*optimization_ptr);
+    }
+    else {
+      evaluateDiagram(diagram,executor,diagram_state);
+    }
+
     return std::move(executor.maybe_return_value);
   }
 
   Optional<Any>
-    maybeEvaluate(
+    maybeEvaluateIn(
+      const DiagramExecutionContext &context,
       const Diagram &diagram,
       const Environment *parent_environment_ptr,
       const Optional<string> &optional_expected_type_name
     ) override
   {
-    ObservedDiagram *maybe_observed_diagram =
-      observed_diagrams.findObservedDiagramFor(diagram);
+    ObservedDiagram *maybe_observed_diagram = nullptr;
+
+    if (observed_diagrams_ptr) {
+      maybe_observed_diagram =
+        observed_diagrams_ptr->findObservedDiagramFor(diagram);
+    }
 
     if (!maybe_observed_diagram) {
-      DiagramEvaluationState temporary_diagram_state;
+      // Nobody is going to see the node states, so we only need to
+      // evaluate what affects the result.
+      const DiagramOptimization &optimization = diagram.optimization();
+
+      DiagramEvaluationState &diagram_state =
+        unobserved_diagram_states.stateFor(diagram);
+
       return
         maybeEvaluateWith(
-          temporary_diagram_state,
+          context,
+          diagram_state,
           diagram,
           parent_environment_ptr,
-          optional_expected_type_name
+          optional_expected_type_name,
+          &optimization
         );
     }
 
     ObservedDiagram &observed_diagram = *maybe_observed_diagram;
-    observed_diagram.maybe_diagram_state.emplace();
+
+    if (!observed_diagram.maybe_diagram_state) {
+      observed_diagram.maybe_diagram_state.emplace();
+    }
+
+    // The state is kept between evaluations so that only the nodes that
+    // were affected by a change have to be evaluated again.
     DiagramEvaluationState &diagram_state =
       *observed_diagram.maybe_diagram_state;
 
     Optional<Any> result =
       maybeEvaluateWith(
+        context,
         diagram_state,
         diagram,
         parent_environment_ptr,
         optional_expected_type_name
       );
 
-    observed_diagram.notifyObserversThatDiagramStateChanged();
+    {
+      std::lock_guard<std::mutex> lock(evaluated_observed_diagrams_mutex);
+      evaluated_observed_diagrams.push_back(&observed_diagram);
+    }
+
     return result;
   }
+
+  // The observers are told about the new states after the evaluation is
+  // done, since diagrams may be evaluated on other threads.
+  void notifyObservers()
+  {
+    for (ObservedDiagram *observed_diagram_ptr : evaluated_observed_diagrams) {
+      observed_diagram_ptr->notifyObserversThatDiagramStateChanged();
+    }
+
+    evaluated_observed_diagrams.clear();
+  }
 };
 }
 
 
-void World::applyCharmaps(const vector<Charmapper*> &charmapper_ptrs)
+namespace {
+// A charmapper application with its own output stream, so that it can be
+// done at the same time as others.
+struct SeparateCharmapperApplication {
+  std::ostringstream stream;
+  DiagramExecutionContext context;
+  ObservedDiagramEvaluator evaluator;
+
+  SeparateCharmapperApplication(
+    const Environment *environment_ptr,
+    ObservedDiagrams *observed_diagrams_ptr,
+    DiagramStatePool &unobserved_diagram_states
+  )
+  : context{stream,stream,environment_ptr},
+    evaluator(context,observed_diagrams_ptr,unobserved_diagram_states)
+  {
+  }
+};
+}
+
+
+// Charmappers that don't share any bodies are applied at the same time.
+// The output of each one is copied to the context afterwards in the order
+// of the charmappers, so it is the same as applying them in order.
+static void
+  applyCharmapsInWaves(
+    const vector<Charmapper*> &charmapper_ptrs,
+    const vector<BodyAccess> &accesses,
+    const DiagramExecutionContext &context,
+    ObservedDiagrams *observed_diagrams_ptr,
+    DiagramStatePool &unobserved_diagram_states,
+    ThreadPool &thread_pool
+  )
 {
-  forEachSceneMember([&](SceneMember &scene_member){
-    scene_member.scene.displayFrame() = scene_member.scene.backgroundFrame();
-  });
+  vector<unique_ptr<SeparateCharmapperApplication>> application_ptrs;
+
+  for (Charmapper *charmapper_ptr : charmapper_ptrs) {
+    assert(charmapper_ptr);
+
+    application_ptrs.push_back(
+      make_unique<SeparateCharmapperApplication>(
+        context.parent_environment_ptr,
+        observed_diagrams_ptr,
+        unobserved_diagram_states
+      )
+    );
+  }
+
+  for (const vector<int> &wave : accessWaves(accesses)) {
+    bool wave_has_one_charmapper = (wave.size()==1);
+
+    thread_pool.run(wave.size(),[&](int task_index,int /*thread_index*/){
+      int i = wave[task_index];
+      ObservedDiagramEvaluator &evaluator = application_ptrs[i]->evaluator;
+
+      if (wave_has_one_charmapper) {
+        // The pool isn't busy with other charmappers, so this charmapper
+        // can use it for its own pos exprs.
+        evaluator.thread_pool_ptr = &thread_pool;
+      }
+
+      charmapper_ptrs[i]->apply(evaluator);
+    });
+  }
 
+  for (auto &application_ptr : application_ptrs) {
+    context.show_stream << application_ptr->stream.str();
+    application_ptr->evaluator.notifyObservers();
+  }
+}
+
+
+static vector<BodyAccess>
+  bodyAccesses(const vector<Charmapper*> &charmapper_ptrs)
+{
+  vector<BodyAccess> accesses;
+
+  for (Charmapper *charmapper_ptr : charmapper_ptrs) {
+    assert(charmapper_ptr);
+    accesses.push_back(charmapper_ptr->bodyAccess());
+  }
+
+  return accesses;
+}
+
+
+void
+  World::applyCharmappers(
+    const vector<Charmapper*> &charmapper_ptrs,
+    const vector<BodyAccess> &accesses,
+    ObservedDiagrams *observed_diagrams_ptr
+  )
+{
   Environment environment;
 
   // for each scene, add a scene object to the environment
@@ -252,13 +402,61 @@ void World::applyCharmaps(const vector<Charmapper*> &charmapper_ptrs)
   DiagramExecutionContext
     context{/*show_stream*/cerr,/*error_stream*/cerr,&environment};
 
-  ObservedDiagramEvaluator evaluator(context,observed_diagrams);
+  if (charmapper_ptrs.size()>1 && thread_pool.nThreads()>1) {
+    applyCharmapsInWaves(
+      charmapper_ptrs,
+      accesses,
+      context,
+      observed_diagrams_ptr,
+      unobserved_diagram_states,
+      thread_pool
+    );
+  }
+  else {
+    ObservedDiagramEvaluator
+      evaluator(context,observed_diagrams_ptr,unobserved_diagram_states);
 
-  for (auto charmapper_ptr : charmapper_ptrs) {
-    assert(charmapper_ptr);
-    charmapper_ptr->apply(evaluator);
+    evaluator.thread_pool_ptr = &thread_pool;
+
+    for (auto charmapper_ptr : charmapper_ptrs) {
+      assert(charmapper_ptr);
+      charmapper_ptr->apply(evaluator);
+    }
+
+    evaluator.notifyObservers();
+  }
+}
+
+
+void
+  World::applyCharmapsToDisplayFrames(
+    const vector<Charmapper*> &charmapper_ptrs,
+    ObservedDiagrams *observed_diagrams_ptr
+  )
+{
+  forEachSceneMember([&](SceneMember &scene_member){
+    scene_member.scene.displayFrame() = scene_member.scene.backgroundFrame();
+  });
+
+  vector<BodyAccess> accesses = bodyAccesses(charmapper_ptrs);
+  int n_charmappers = charmapper_ptrs.size();
+  charmappers_applied_with_unknown_access.clear();
+
+  for (int i=0; i!=n_charmappers; ++i) {
+    if (!accesses[i].is_known) {
+      charmappers_applied_with_unknown_access.push_back(charmapper_ptrs[i]);
+    }
   }
 
+  applyCharmappers(charmapper_ptrs,accesses,observed_diagrams_ptr);
+  unobserved_diagram_states.releaseUnusedStates();
+}
+
+
+void World::applyCharmaps(const vector<Charmapper*> &charmapper_ptrs)
+{
+  applyCharmapsToDisplayFrames(charmapper_ptrs,&observed_diagrams);
+
   forEachSceneMember([&](const SceneMember &scene_member){
     if (scene_member.scene_window_ptr) {
       scene_member.scene_window_ptr->notifySceneChanged();
@@ -267,6 +465,107 @@ void World::applyCharmaps(const vector<Charmapper*> &charmapper_ptrs)
 }
 
 
+auto World::bakeCharmaps(int begin_frame_index,int end_frame_index)
+  -> BakeResult
+{
+  assert(begin_frame_index>=0);
+  assert(begin_frame_index<=end_frame_index);
+
+  Clock::time_point start_time = Clock::now();
+  vector<Charmapper*> charmapper_ptrs = allCharmapPtrs();
+  vector<SceneMember *> scene_member_ptrs;
+
+  forEachSceneMember([&](SceneMember &scene_member){
+    scene_member_ptrs.push_back(&scene_member);
+  });
+
+  int n_scenes = scene_member_ptrs.size();
+  int n_frames = end_frame_index - begin_frame_index;
+  BakeResult result;
+  result.scene_motions.resize(n_scenes);
+
+  for (Scene::Motion &motion : result.scene_motions) {
+    motion.frames.resize(n_frames);
+  }
+
+  // Each task bakes its own part of the range.  The frames in a part
+  // follow each other, so the diagram states from one frame are likely to
+  // be reused for the next.
+  int n_tasks = std::max(1,std::min(thread_pool.nThreads(),n_frames));
+  vector<DiagramStatePool> diagram_states(n_tasks);
+  vector<std::ostringstream> streams(n_tasks);
+
+  thread_pool.run(n_tasks,[&](int task_index,int /*thread_index*/){
+    // The scenes are left alone.  The bodies are positioned in display
+    // frames that only this task uses, and the scene objects find the
+    // bodies in those frames.
+    DisplayFrames display_frames;
+    Environment environment;
+
+    for (SceneMember *scene_member_ptr : scene_member_ptrs) {
+      Scene &scene = scene_member_ptr->scene;
+      display_frames.entries.push_back({&scene,Scene::Frame()});
+
+      environment[scene_member_ptr->name] =
+        makeSceneObject(scene,&display_frames);
+    }
+
+    std::ostream &stream = streams[task_index];
+    DiagramExecutionContext context{stream,stream,&environment};
+
+    // Nothing is shown while baking, so the observed diagrams keep the
+    // states from the current frame.
+    ObservedDiagramEvaluator
+      evaluator(
+        context,
+        /*observed_diagrams_ptr*/nullptr,
+        diagram_states[task_index]
+      );
+
+    int begin_offset = n_frames*task_index/n_tasks;
+    int end_offset = n_frames*(task_index + 1)/n_tasks;
+
+    for (int offset=begin_offset; offset!=end_offset; ++offset) {
+      int frame_index = begin_frame_index + offset;
+
+      for (int i=0; i!=n_scenes; ++i) {
+        const Scene::Motion &motion =
+          scene_member_ptrs[i]->scene.backgroundMotion();
+
+        int last_frame_index = motion.nFrames() - 1;
+
+        display_frames.entries[i].frame =
+          motion.frames[std::min(frame_index,last_frame_index)];
+      }
+
+      // The first plan of each charmapper is kept for the scenes' own
+      // display frames.
+      for (Charmapper *charmapper_ptr : charmapper_ptrs) {
+        charmapper_ptr->apply(
+          evaluator,&display_frames,/*plan_index*/task_index + 1
+        );
+      }
+
+      for (int i=0; i!=n_scenes; ++i) {
+        result.scene_motions[i].frames[offset] =
+          display_frames.entries[i].frame;
+      }
+    }
+  });
+
+  for (std::ostringstream &stream : streams) {
+    cerr << stream.str();
+  }
+
+  result.n_frames = n_frames;
+
+  result.seconds =
+    std::chrono::duration<double>(Clock::now() - start_time).count();
+
+  return result;
+}
+
+
 CharmapperMember &World::charmapperMember(int index)
 {
   Member *member_ptr = world_members[index].get();
@@ -326,9 +625,131 @@ unique_ptr<Member> World::removeMember(int index)
 }
 
 
-void World::notifyDiagramChanged(const Diagram &)
+static const Scene::Body &topBody(const Scene::Body &body)
+{
+  const Scene::Body *body_ptr = &body;
+
+  while (body_ptr->parentPtr()) {
+    body_ptr = body_ptr->parentPtr();
+  }
+
+  return *body_ptr;
+}
+
+
+static void
+  resetDisplayedBodyPosition(Scene &scene,const Scene::Body &body)
 {
-  applyCharmaps();
+  const Scene::Point2DMap &position_map = body.position_map;
+
+  for (Scene::VarIndex var_index :
+       {position_map.x.var_index,position_map.y.var_index}) {
+    if (var_index!=Scene::noVarIndex()) {
+      scene.displayFrame().var_values[var_index] =
+        scene.backgroundFrame().var_values[var_index];
+    }
+  }
+}
+
+
+void World::notifyDiagramChanged(const Diagram &diagram)
+{
+  vector<Charmapper*> charmapper_ptrs = allCharmapPtrs();
+  int n_charmappers = charmapper_ptrs.size();
+  int changed_index = 0;
+
+  while (changed_index!=n_charmappers &&
+         !charmapper_ptrs[changed_index]->usesDiagram(diagram)) {
+    ++changed_index;
+  }
+
+  bool display_frames_are_current = true;
+
+  forEachSceneMember([&](SceneMember &scene_member){
+    Scene &scene = scene_member.scene;
+
+    if (scene.displayFrame().nVariables()!=scene.nFrameVariables()) {
+      display_frames_are_current = false;
+    }
+  });
+
+  if (changed_index==n_charmappers || !display_frames_are_current) {
+    applyCharmaps();
+    return;
+  }
+
+  // The charmapper with the diagram is applied again along with every
+  // charmapper that shares a body with it, directly or through other
+  // charmappers.  None of the others write the bodies that these use or
+  // use the bodies that these write, so what they did stays the same.
+  vector<BodyAccess> accesses = bodyAccesses(charmapper_ptrs);
+  vector<bool> is_affected(n_charmappers,false);
+  BodyAccess affected_access = accesses[changed_index];
+  is_affected[changed_index] = true;
+  bool affected_charmappers_changed = true;
+
+  while (affected_charmappers_changed) {
+    affected_charmappers_changed = false;
+
+    for (int i=0; i!=n_charmappers; ++i) {
+      if (!is_affected[i] && accessesConflict(accesses[i],affected_access)) {
+        is_affected[i] = true;
+        affected_access.add(accesses[i]);
+        affected_charmappers_changed = true;
+      }
+    }
+  }
+
+  vector<Charmapper*> affected_charmapper_ptrs;
+  vector<BodyAccess> affected_accesses;
+
+  for (int i=0; i!=n_charmappers; ++i) {
+    if (is_affected[i]) {
+      const vector<const Charmapper *> &unknown_ptrs =
+        charmappers_applied_with_unknown_access;
+
+      bool was_applied_with_unknown_access =
+        std::find(unknown_ptrs.begin(),unknown_ptrs.end(),charmapper_ptrs[i])!=
+        unknown_ptrs.end();
+
+      if (!accesses[i].is_known || was_applied_with_unknown_access) {
+        // This could have changed any body.
+        applyCharmaps();
+        return;
+      }
+
+      affected_charmapper_ptrs.push_back(charmapper_ptrs[i]);
+      affected_accesses.push_back(accesses[i]);
+    }
+  }
+
+  vector<SceneMember *> changed_scene_member_ptrs;
+
+  forEachSceneMember([&](SceneMember &scene_member){
+    Scene &scene = scene_member.scene;
+    bool scene_is_changed = false;
+
+    for (const Scene::Body *body_ptr : affected_access.written_body_ptrs) {
+      if (&topBody(*body_ptr)==&scene.rootBody()) {
+        resetDisplayedBodyPosition(scene,*body_ptr);
+        scene_is_changed = true;
+      }
+    }
+
+    if (scene_is_changed) {
+      changed_scene_member_ptrs.push_back(&scene_member);
+    }
+  });
+
+  applyCharmappers(
+    affected_charmapper_ptrs,affected_accesses,&observed_diagrams
+  );
+
+  for (SceneMember *scene_member_ptr : changed_scene_member_ptrs) {
+    if (scene_member_ptr->scene_window_ptr) {
+      scene_member_ptr->scene_window_ptr->notifySceneChanged();
+    }
+  }
 }
 
 
@@ -8,6 +8,8 @@
 #include "scene.hpp"
 #include "scenewindow.hpp"
 #include "observeddiagrams.hpp"
+#include "diagramstatepool.hpp"
+#include "threadpool.hpp"
 
 
 class World {
@@ -17,8 +19,13 @@ class World {
     struct SceneMember;
     struct CharmapperMember;
     struct Member;
+    struct BakeResult;
 
     World();
+    explicit World(int n_threads);
+      // The charmappers are applied using this many threads.  By default
+      // there is one for each processor.
+
     ~World();
 
     Charmapper& addCharmapper();
@@ -29,6 +36,19 @@ class World {
     void applyCharmaps();
     void applyCharmaps(const std::vector<Charmapper*> &);
 
+    void notifyDiagramChanged(const Diagram &);
+      // Only the charmapper that has the diagram and the charmappers
+      // that share bodies with it are applied again, and only the scenes
+      // with bodies that they position are told about the change.
+
+    BakeResult bakeCharmaps(int begin_frame_index,int end_frame_index);
+      // This applies all the charmappers to each of the background frames
+      // in the range, and collects the display frames that result into a
+      // new motion for each scene.  Scenes with fewer frames use their
+      // last frame for the rest of the range.  The current frames and
+      // display frames are left as they were.  The range is split between
+      // the threads, which each work on their own display frames.
+
     CharmapperMember &charmapperMember(int member_index);
     SceneMember &sceneMember(int member_index);
     const SceneMember &sceneMember(int member_index) const;
@@ -58,6 +78,19 @@ class World {
     void visitMember(int child_index,const ConstMemberVisitor &) const;
 
   public:
+    struct BakeResult {
+      std::vector<Scene::Motion> scene_motions;
+        // One for each scene, in the order that forEachSceneMember()
+        // visits them.
+      int n_frames = 0;
+      double seconds = 0;
+
+      double framesPerSecond() const
+      {
+        return seconds>0 ? n_frames/seconds : 0;
+      }
+    };
+
     struct Member {
       std::string name;
 
@@ -156,6 +189,15 @@ class World {
     using WorldMembers = std::vector<std::unique_ptr<Member>>;
 
     WorldMembers world_members;
+    DiagramStatePool unobserved_diagram_states;
+      // Evaluation states for the diagrams that aren't observed, so they
+      // can be reused from one application of the charmaps to the next.
+    ThreadPool thread_pool;
+      // For evaluating diagrams that don't depend on each other at the
+      // same time, and for baking several frames at the same time.
+    std::vector<const Charmapper *> charmappers_applied_with_unknown_access;
+      // These could have changed any body the last time they were
+      // applied.
 
     const Member* findMember(const std::string &name) const;
     virtual SceneWindow& createSceneViewerWindow(SceneMember &) = 0;
@@ -227,7 +269,19 @@ class World {
     }
 
     std::vector<Charmapper*> allCharmapPtrs();
-    void notifyDiagramChanged(const Diagram &);
+
+    void
+      applyCharmappers(
+        const std::vector<Charmapper*> &,
+        const std::vector<BodyAccess> &,
+        ObservedDiagrams *observed_diagrams_ptr
+      );
+
+    void
+      applyCharmapsToDisplayFrames(
+        const std::vector<Charmapper*> &,
+        ObservedDiagrams *observed_diagrams_ptr
+      );
 
     void
       sceneMemberFrameVariblesChanged(
@@ -1,6 +1,7 @@
 #include "world.hpp"
 
 #include <cstdlib>
+#include <algorithm>
 #include <sstream>
 #include "viewportrect.hpp"
 #include "sceneviewerimpl.hpp"
@@ -162,9 +163,197 @@ static void testSceneMemberIndex()
 }
 
 
+static void testBakingCharmaps()
+{
+  Tester tester;
+  FakeWorld &world = tester.world;
+  Scene &scene = world.addScene();
+  Scene::Body &body1 = scene.addBody();
+  Scene::Body &body2 = scene.addBody();
+  Scene::Motion &motion = scene.backgroundMotion();
+  motion.addFrame();
+  motion.addFrame();
+
+  for (int i=0; i!=3; ++i) {
+    setBodyPosition(body1,motion.frames[i],Point2D(i*10,0));
+  }
+
+  Charmapper &charmapper = world.addCharmapper();
+  auto &pos_expr = charmapper.addMotionPass().addPosExpr();
+  pos_expr.target_body_link = BodyLink(&scene,&body2);
+  pos_expr.global_position.switchToFromBody();
+  pos_expr.global_position.fromBody().source_body_link.set(&scene,&body1);
+  pos_expr.global_position.fromBody().local_position.x.value = 1;
+  scene.setCurrentFrameIndex(2);
+  world.applyCharmaps();
+  Scene::Frame display_frame = scene.displayFrame();
+
+  World::BakeResult result = world.bakeCharmaps(0,4);
+  assert(result.n_frames==4);
+  assert(result.framesPerSecond()>=0);
+  assert(result.scene_motions.size()==1);
+  const Scene::Motion &baked_motion = result.scene_motions[0];
+  assert(baked_motion.nFrames()==4);
+  assert(bodyPosition(body2,baked_motion.frames[0])==Point2D(1,0));
+  assert(bodyPosition(body2,baked_motion.frames[1])==Point2D(11,0));
+  assert(bodyPosition(body2,baked_motion.frames[2])==Point2D(21,0));
+  assert(bodyPosition(body2,baked_motion.frames[3])==Point2D(21,0));
+
+  assert(scene.currentFrameIndex()==2);
+  assert(scene.displayFrame().var_values==display_frame.var_values);
+}
+
+
+static Charmapper::MotionPass::PosExpr &
+  addFromBodyPosExpr(
+    Charmapper &charmapper,
+    Scene &scene,
+    Scene::Body &source_body,
+    Scene::Body &target_body,
+    float x
+  )
+{
+  auto &pos_expr = charmapper.addMotionPass().addPosExpr();
+  pos_expr.target_body_link = BodyLink(&scene,&target_body);
+  pos_expr.global_position.switchToFromBody();
+  pos_expr.global_position.fromBody().source_body_link.set(&scene,&source_body);
+  pos_expr.global_position.fromBody().local_position.x.value = x;
+  return pos_expr;
+}
+
+
+static void testApplyingSeparateCharmappers()
+{
+  FakeWorld world(3);
+  Scene &scene = world.addScene();
+  Scene::Body &body1 = scene.addBody();
+  Scene::Body &body2 = scene.addBody();
+  Scene::Body &body3 = scene.addBody();
+  Scene::Body &body4 = scene.addBody();
+  Scene::Body &body5 = scene.addBody();
+  setBodyPosition(body1,scene.backgroundFrame(),Point2D(10,0));
+  setBodyPosition(body4,scene.backgroundFrame(),Point2D(20,0));
+  Charmapper &charmapper1 = world.addCharmapper();
+  Charmapper &charmapper2 = world.addCharmapper();
+  Charmapper &charmapper3 = world.addCharmapper();
+  addFromBodyPosExpr(charmapper1,scene,body1,body2,1);
+  addFromBodyPosExpr(charmapper2,scene,body4,body5,2);
+
+  // This one reads the body that the first one writes, so it has to wait
+  // for it.
+  addFromBodyPosExpr(charmapper3,scene,body2,body3,3);
+
+  assert(charmapper1.bodyAccess().is_known);
+  assert(charmapper1.bodyAccess().written_body_ptrs.size()==1);
+
+  for (int i=0; i!=10; ++i) {
+    world.applyCharmaps();
+    assert(bodyPosition(body2,scene.displayFrame())==Point2D(11,0));
+    assert(bodyPosition(body3,scene.displayFrame())==Point2D(14,0));
+    assert(bodyPosition(body5,scene.displayFrame())==Point2D(22,0));
+  }
+}
+
+
+static void testBakingCharmapsOnSeveralThreads()
+{
+  FakeWorld world(3);
+  Scene &scene = world.addScene();
+  Scene::Body &body1 = scene.addBody();
+  Scene::Body &body2 = scene.addBody();
+  Scene::Body &body3 = scene.addBody();
+  Scene::Motion &motion = scene.backgroundMotion();
+
+  while (motion.nFrames()!=7) {
+    motion.addFrame();
+  }
+
+  for (int i=0; i!=7; ++i) {
+    setBodyPosition(body1,motion.frames[i],Point2D(i*10,0));
+  }
+
+  Charmapper &charmapper1 = world.addCharmapper();
+  Charmapper &charmapper2 = world.addCharmapper();
+  addFromBodyPosExpr(charmapper1,scene,body1,body2,1);
+
+  // This reads the body that the first one positions in the same frame.
+  addFromBodyPosExpr(charmapper2,scene,body2,body3,2);
+
+  world.applyCharmaps();
+  Scene::Frame display_frame = scene.displayFrame();
+
+  for (int i=0; i!=2; ++i) {
+    World::BakeResult result = world.bakeCharmaps(0,8);
+    assert(result.n_frames==8);
+    const Scene::Motion &baked_motion = result.scene_motions[0];
+    assert(baked_motion.nFrames()==8);
+
+    for (int j=0; j!=8; ++j) {
+      float x = std::min(j,6)*10;
+      const Scene::Frame &frame = baked_motion.frames[j];
+      assert(bodyPosition(body2,frame)==Point2D(x + 1,0));
+      assert(bodyPosition(body3,frame)==Point2D(x + 3,0));
+    }
+  }
+
+  assert(scene.currentFrameIndex()==0);
+  assert(scene.displayFrame().var_values==display_frame.var_values);
+}
+
+
+static void testChangingADiagram()
+{
+  Tester tester;
+  FakeWorld &world = tester.world;
+  Scene &scene = world.addScene();
+  Scene::Body &body1 = scene.addBody();
+  Scene::Body &body2 = scene.addBody();
+  Scene::Body &body3 = scene.addBody();
+  Scene::Body &body4 = scene.addBody();
+  Scene::Body &body5 = scene.addBody();
+  setBodyPosition(body1,scene.backgroundFrame(),Point2D(10,0));
+  setBodyPosition(body4,scene.backgroundFrame(),Point2D(20,0));
+  Charmapper &charmapper1 = world.addCharmapper();
+  Charmapper &charmapper2 = world.addCharmapper();
+  Charmapper &charmapper3 = world.addCharmapper();
+  Charmapper &charmapper4 = world.addCharmapper();
+  auto &pos_expr1 = addFromBodyPosExpr(charmapper1,scene,body1,body2,1);
+  addFromBodyPosExpr(charmapper2,scene,body4,body5,2);
+  addFromBodyPosExpr(charmapper3,scene,body2,body3,3);
+  auto &pos_expr4 = charmapper4.addMotionPass().addPosExpr();
+  world.applyCharmaps();
+  FakeSceneViewer &viewer = world.window().viewer_member;
+
+  // Moving the body by hand shows whether the charmapper that positions
+  // it was applied again.
+  setBodyPosition(body5,scene.displayFrame(),Point2D(0,0));
+
+  pos_expr1.global_position.fromBody().local_position.x.value = 5;
+  int old_redraw_count = viewer.redraw_count;
+  world.notifyDiagramChanged(pos_expr1.diagram);
+  assert(bodyPosition(body2,scene.displayFrame())==Point2D(15,0));
+  assert(bodyPosition(body3,scene.displayFrame())==Point2D(18,0));
+  assert(bodyPosition(body5,scene.displayFrame())==Point2D(0,0));
+  assert(viewer.redraw_count==old_redraw_count+1);
+
+  // The last charmapper doesn't position any bodies, so changing it
+  // doesn't change the scene.
+  old_redraw_count = viewer.redraw_count;
+  world.notifyDiagramChanged(pos_expr4.diagram);
+  assert(viewer.redraw_count==old_redraw_count);
+
+  world.applyCharmaps();
+  assert(bodyPosition(body5,scene.displayFrame())==Point2D(22,0));
+}
+
+
 int main()
 {
   testAddingAScene();
   testSceneMemberIndex();
   testMovingABody();
+  testBakingCharmaps();
+  testApplyingSeparateCharmappers();
+  testBakingCharmapsOnSeveralThreads();
+  testChangingADiagram();
 }
@@ -51,7 +51,7 @@ struct WorldSceneList : CharmapperWrapper::SceneList {
 
     function<void(const Scene::Body&)> add_body_name_function =
       [&](const Scene::Body &body){
-        scene_body_names.push_back(body.name);
+        scene_body_names.push_back(body.name());
       };
 
     forEachBodyInScene(scene,add_body_name_function);
@@ -365,8 +365,8 @@ void
     };
 
   function<void(const Diagram &)> diagram_changed_function =
-    [&world = this->world](const Diagram &){
-      world.applyCharmaps();
+    [&world = this->world](const Diagram &diagram){
+      world.notifyDiagramChanged(diagram);
     };
 
   ChildWrapperVisitor